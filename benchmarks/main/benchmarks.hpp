@@ -0,0 +1,16 @@
+#pragma once
+
+/// Load profiles with committed baselines in tools/perf_regression/baselines.
+void run_regression_suite();
+
+/// Full-speed throughput and latency for 1 to 16 producers, pinned and
+/// unpinned, per capture strategy; printed as CSV rows for plotting.
+void run_scaling_suite();
+
+/// Producer-side cycles of loggable::espidf::log_info() against ESP_LOGI
+/// for the same lines; printed as CSV rows.
+void run_format_suite();
+
+/// Drain task throughput on queued bursts; build once more with
+/// sdkconfig.unbatched for the unbatched side. Printed as CSV rows.
+void run_drain_suite();
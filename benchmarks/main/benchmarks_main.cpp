@@ -0,0 +1,21 @@
+#include "benchmarks.hpp"
+#include "loggable_espidf.hpp"
+#include <cstdio>
+
+using loggable::espidf::HookConfig;
+using loggable::espidf::LogHook;
+
+extern "C" void app_main() {
+    // Console output would dominate every measurement; results go to stdout directly.
+    HookConfig config;
+    config.call_original_vprintf = false;
+    LogHook::configure(config);
+    LogHook::install();
+
+    run_regression_suite();
+    run_scaling_suite();
+    run_format_suite();
+    run_drain_suite();
+
+    std::printf("benchmarks done\n");
+}
@@ -0,0 +1,121 @@
+#include "benchmarks.hpp"
+#include "loggable_espidf.hpp"
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+
+using loggable::espidf::IRecordSink;
+using loggable::espidf::LogHook;
+using loggable::espidf::Record;
+
+namespace {
+
+constexpr const char* TAG = "bench_drain";
+constexpr int kRounds = 5;
+constexpr size_t kLengths[] = {32, 96, 200};
+
+/**
+ * Holds the drain task in its first delivery until opened, so a burst can
+ * be queued behind it and then timed as pure drain and delivery work.
+ */
+class GateSink : public IRecordSink {
+public:
+    GateSink() : _open(xSemaphoreCreateBinary()), _done(xSemaphoreCreateBinary()) {}
+
+    void arm(uint32_t lines) {
+        _delivered.store(0, std::memory_order_relaxed);
+        _target = lines;
+        _closed.store(true, std::memory_order_release);
+    }
+
+    /// Whether the drain task is waiting at the gate.
+    bool holding() const { return _holding.load(std::memory_order_acquire); }
+
+    void open() {
+        _holding.store(false, std::memory_order_relaxed);
+        xSemaphoreGive(_open);
+    }
+
+    bool wait_done(uint32_t timeout_ms) { return xSemaphoreTake(_done, pdMS_TO_TICKS(timeout_ms)) == pdTRUE; }
+
+    void consume(const Record& record) override {
+        if (record.tag != TAG) {
+            return;
+        }
+        if (_closed.exchange(false, std::memory_order_acq_rel)) {
+            _holding.store(true, std::memory_order_release);
+            xSemaphoreTake(_open, portMAX_DELAY);
+        }
+        if (_delivered.fetch_add(1, std::memory_order_relaxed) + 1 == _target) {
+            xSemaphoreGive(_done);
+        }
+    }
+
+private:
+    SemaphoreHandle_t _open;
+    SemaphoreHandle_t _done;
+    std::atomic<bool> _closed{false};
+    std::atomic<bool> _holding{false};
+    std::atomic<uint32_t> _delivered{0};
+    uint32_t _target = 0;
+};
+
+char filler[256];
+
+/// Lines per second for one burst, or 0 if it was not fully delivered.
+uint32_t drain_burst(GateSink& sink, size_t length, uint32_t lines) {
+    sink.arm(lines);
+    ESP_LOGI(TAG, "%.*s", static_cast<int>(length), filler);
+    while (!sink.holding()) {
+        vTaskDelay(1);
+    }
+    for (uint32_t i = 1; i < lines; ++i) {
+        ESP_LOGI(TAG, "%.*s", static_cast<int>(length), filler);
+    }
+    const int64_t start = esp_timer_get_time();
+    sink.open();
+    if (!sink.wait_done(1000)) {
+        return 0;
+    }
+    const int64_t elapsed = std::max<int64_t>(esp_timer_get_time() - start, 1);
+    return static_cast<uint32_t>((lines - 1) * 1000000ll / elapsed);
+}
+
+} // namespace
+
+void run_drain_suite() {
+    // The gate would stop the producer itself if lines were delivered on it.
+    if (!LogHook::config().async_capture) {
+        std::printf("drain,skipped: needs async capture\n");
+        return;
+    }
+    std::fill(std::begin(filler), std::end(filler), 'x');
+    auto sink = std::make_shared<GateSink>();
+    LogHook::add_record_sink(sink);
+    std::printf("drain,batch_bytes,line_length,lines,lines_per_second,delivery_allocations_per_line\n");
+    for (const size_t length : kLengths) {
+        // Stay within one producer's guaranteed part of the capture buffer,
+        // with room for the header and the entry overhead.
+        const uint32_t lines = CONFIG_LOGGABLE_ESPIDF_CAPTURE_BUFFER_SIZE / 2 / (length + 64);
+        uint32_t rates[kRounds];
+        (void)LogHook::allocation_report(true);
+        for (int round = 0; round < kRounds; ++round) {
+            rates[round] = drain_burst(*sink, length, lines);
+        }
+        const auto allocations = LogHook::allocation_report();
+        const double per_line = allocations.deliveries ? static_cast<double>(allocations.delivery_allocations) /
+                                                             allocations.deliveries
+                                                       : 0.0;
+        std::sort(rates, rates + kRounds);
+        std::printf("drain,%u,%u,%u,%u,%.3f\n", static_cast<unsigned>(CONFIG_LOGGABLE_ESPIDF_DRAIN_BATCH_BYTES),
+                    static_cast<unsigned>(length), static_cast<unsigned>(lines),
+                    static_cast<unsigned>(rates[kRounds / 2]), per_line);
+    }
+    LogHook::remove_record_sink(sink);
+}
@@ -0,0 +1,56 @@
+#include "benchmarks.hpp"
+#include "loggable_espidf_format.hpp"
+#include <esp_cpu.h>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+
+namespace espidf = loggable::espidf;
+
+namespace {
+
+constexpr const char* TAG = "bench_fmt";
+constexpr size_t kCalls = 2048;
+/// Calls between pauses that let the drain task empty the capture buffer.
+constexpr size_t kBatch = 64;
+
+/// Time `call` on the calling task and print its cycle percentiles as a CSV row.
+template <typename Call>
+void measure(const char* shape, const char* api, Call&& call) {
+    static uint32_t samples[kCalls];
+    for (size_t i = 0; i < kCalls; ++i) {
+        if (i % kBatch == 0) {
+            vTaskDelay(pdMS_TO_TICKS(20));
+        }
+        const uint32_t start = esp_cpu_get_cycle_count();
+        call(static_cast<uint32_t>(i));
+        samples[i] = esp_cpu_get_cycle_count() - start;
+    }
+    std::sort(samples, samples + kCalls);
+    std::printf("format_cost,%s,%s,%u,%u,%u\n", shape, api, static_cast<unsigned>(kCalls),
+                static_cast<unsigned>(samples[kCalls / 2]), static_cast<unsigned>(samples[kCalls * 99 / 100]));
+}
+
+} // namespace
+
+void run_format_suite() {
+    const char* sensor = "bme280";
+    std::printf("format_cost,shape,api,calls,cycles_p50,cycles_p99\n");
+
+    measure("int", "ESP_LOGI", [](uint32_t i) { ESP_LOGI(TAG, "reading %" PRIu32, i); });
+    measure("int", "log_info", [](uint32_t i) { espidf::log_info(TAG, "reading {}", i); });
+
+    measure("int+string", "ESP_LOGI", [&](uint32_t i) { ESP_LOGI(TAG, "sensor %s reading %" PRIu32, sensor, i); });
+    measure("int+string", "log_info", [&](uint32_t i) { espidf::log_info(TAG, "sensor {} reading {}", sensor, i); });
+
+    measure("mixed", "ESP_LOGI", [&](uint32_t i) {
+        ESP_LOGI(TAG, "id %" PRIu32 " temp %.2f state %s addr %p", i, i * 0.25, sensor, sensor);
+    });
+    measure("mixed", "log_info", [&](uint32_t i) {
+        espidf::log_info(TAG, "id {} temp {:.2f} state {} addr {}", i, i * 0.25, sensor,
+                         static_cast<const void*>(sensor));
+    });
+}
@@ -0,0 +1,43 @@
+#include "benchmarks.hpp"
+#include "loggable_espidf_loadgen.hpp"
+#include <cstdio>
+
+using loggable::espidf::LoadGenerator;
+using loggable::espidf::LoadProfile;
+using loggable::espidf::LoadResult;
+
+namespace {
+
+/// Paced profiles that must not drop or allocate; keep in step with baselines/loadgen.jsonl.
+LoadProfile regression_profile(uint32_t seed, size_t tasks, bool pinned, uint32_t lines_per_second, size_t tags,
+                               size_t max_line_length, uint8_t partial_percent) {
+    LoadProfile profile;
+    profile.seed = seed;
+    profile.tasks = tasks;
+    profile.pinned = pinned;
+    profile.lines_per_second = lines_per_second;
+    profile.tag_count = tags;
+    profile.max_line_length = max_line_length;
+    profile.partial_percent = partial_percent;
+    return profile;
+}
+
+} // namespace
+
+void run_regression_suite() {
+    const LoadProfile profiles[] = {
+        regression_profile(1, 4, true, 200, 4, 96, 0),
+        regression_profile(2, 4, false, 200, 4, 96, 0),
+        regression_profile(3, 2, true, 500, 8, 160, 20),
+    };
+    static char json[768];
+    for (const LoadProfile& profile : profiles) {
+        LoadResult result;
+        if (!LoadGenerator::run(profile, result)) {
+            std::printf("regression: run with seed %u failed\n", static_cast<unsigned>(profile.seed));
+            continue;
+        }
+        LoadGenerator::to_json(profile, result, json, sizeof(json));
+        std::printf("%s\n", json);
+    }
+}
@@ -0,0 +1,59 @@
+#include "benchmarks.hpp"
+#include "loggable_espidf.hpp"
+#include "loggable_espidf_loadgen.hpp"
+#include <cstdio>
+
+using loggable::espidf::HookConfig;
+using loggable::espidf::LoadGenerator;
+using loggable::espidf::LoadProfile;
+using loggable::espidf::LoadResult;
+using loggable::espidf::LogHook;
+
+namespace {
+
+/// How lines get from the producer to the sinks.
+struct Strategy {
+    const char* name;
+    bool async_capture;
+};
+
+constexpr Strategy kStrategies[] = {
+    {"ring", true},   // Shared capture ring, delivered by the drain task.
+    {"sync", false},  // Delivered on the producer, serialized by the Sinker.
+};
+
+constexpr size_t kProducerCounts[] = {1, 2, 3, 4, 6, 8, 12, 16};
+
+} // namespace
+
+void run_scaling_suite() {
+    const HookConfig saved = LogHook::config();
+    std::printf("scaling,strategy,pinning,producers,lines_per_second,cycles_p50,cycles_p99,dropped_lines,"
+                "lock_acquisitions,lock_contentions\n");
+    for (const Strategy& strategy : kStrategies) {
+        HookConfig config = saved;
+        config.async_capture = strategy.async_capture;
+        LogHook::configure(config);
+        for (const bool pinned : {true, false}) {
+            for (const size_t tasks : kProducerCounts) {
+                LoadProfile profile;
+                profile.seed = 100;
+                profile.tasks = tasks;
+                profile.pinned = pinned;
+                profile.duration_ms = 1000;
+                LoadResult result;
+                if (!LoadGenerator::run(profile, result)) {
+                    std::printf("scaling,%s,%s,%zu,failed\n", strategy.name, pinned ? "pinned" : "unpinned", tasks);
+                    continue;
+                }
+                std::printf("scaling,%s,%s,%zu,%u,%u,%u,%u,%u,%u\n", strategy.name, pinned ? "pinned" : "unpinned",
+                            tasks, static_cast<unsigned>(result.lines_per_second),
+                            static_cast<unsigned>(result.latency_p50), static_cast<unsigned>(result.latency_p99),
+                            static_cast<unsigned>(result.dropped_lines),
+                            static_cast<unsigned>(result.lock_acquisitions),
+                            static_cast<unsigned>(result.lock_contentions));
+            }
+        }
+    }
+    LogHook::configure(saved);
+}
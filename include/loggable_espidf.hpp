@@ -1,10 +1,359 @@
 #pragma once
 
+#include "loggable.hpp"
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 #include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#ifndef CONFIG_LOGGABLE_ESPIDF_VOLUME_SLOTS
+#define CONFIG_LOGGABLE_ESPIDF_VOLUME_SLOTS 16
+#endif
+
+#ifndef CONFIG_LOGGABLE_ESPIDF_TAG_LEVEL_SLOTS
+#define CONFIG_LOGGABLE_ESPIDF_TAG_LEVEL_SLOTS 32
+#endif
+
+#ifndef CONFIG_LOGGABLE_ESPIDF_PARTIAL_LINE_TIMEOUT_MS
+#define CONFIG_LOGGABLE_ESPIDF_PARTIAL_LINE_TIMEOUT_MS 1000
+#endif
+
+#ifndef CONFIG_LOGGABLE_ESPIDF_CONTINUATION_WINDOW_MS
+#define CONFIG_LOGGABLE_ESPIDF_CONTINUATION_WINDOW_MS 20
+#endif
 
 namespace loggable {
 namespace espidf {
 
+/// Number of producers tracked by each log volume table.
+inline constexpr size_t kVolumeSlots = CONFIG_LOGGABLE_ESPIDF_VOLUME_SLOTS;
+
+/**
+ * @brief Log volume charged to one task or tag.
+ *
+ * Counts are upper bounds: when a producer displaces a smaller one from the
+ * bounded table it inherits its counts, and `error` records how many of the
+ * lines may belong to other producers.
+ */
+struct VolumeEntry {
+    char name[16];
+    uint32_t lines;
+    uint64_t bytes;
+    uint64_t cycles;
+    uint32_t error;
+};
+
+/**
+ * @brief Heaviest log producers over a reporting window, most lines first.
+ */
+struct VolumeReport {
+    uint32_t window_ms;
+    uint32_t total_lines;
+    uint64_t total_bytes;
+    uint64_t total_cycles;
+    size_t task_count;
+    VolumeEntry tasks[kVolumeSlots];
+    size_t tag_count;
+    VolumeEntry tags[kVolumeSlots];
+};
+
+using VolumeReportCallback = void (*)(const VolumeReport& report, void* user);
+
+/**
+ * @brief Stages a line passes through between the log call and the sinks.
+ *
+ * Timed for lines that enter through the vprintf hook when built with
+ * CONFIG_LOGGABLE_ESPIDF_LATENCY_TRACE.
+ */
+enum class LatencyStage : uint8_t {
+    Capture,      ///< Hook entry to commit into the capture buffer, or to synchronous dispatch.
+    Queue,        ///< Commit to the start of delivery on the drain task.
+    RecordSinks,  ///< Time spent in the record sinks.
+    Sinker,       ///< Time spent in Sinker::dispatch().
+    EndToEnd,     ///< Hook entry to the return of the last sink.
+};
+
+inline constexpr size_t kLatencyStages = 5;
+
+/// Latency distribution of one stage in microseconds, within 12.5%.
+struct LatencyStats {
+    uint64_t count;
+    uint32_t p50;
+    uint32_t p90;
+    uint32_t p99;
+    uint32_t p999;
+    uint32_t max;
+};
+
+/// Per-stage latencies over a window, indexed by LatencyStage.
+struct LatencyReport {
+    uint32_t window_ms;
+    LatencyStats stages[kLatencyStages];
+};
+
+/**
+ * @brief Heap allocations made on the logging paths over a window.
+ *
+ * Collected with CONFIG_LOGGABLE_ESPIDF_ALLOC_COUNTERS. Allocations by a
+ * task inside the vprintf hook count as hook allocations, those made while
+ * dispatching to sinks (the Sinker, record sinks and whatever they call)
+ * as delivery allocations.
+ */
+struct AllocationReport {
+    uint32_t hook_lines;            ///< Lines committed by the hook.
+    uint32_t hook_allocations;
+    uint32_t deliveries;            ///< Records delivered to the sinks.
+    uint32_t delivery_allocations;
+};
+
+/**
+ * @brief Allowed steady-state allocations per line on each path.
+ *
+ * The hook reuses each task's line buffer, so once the buffer has grown to
+ * the task's longest line a hook line costs no allocation. Lines of 256
+ * bytes or more are formatted into a temporary and cost one.
+ */
+struct AllocationBudget {
+    uint32_t per_hook_line = 0;
+    uint32_t per_delivery = 0;
+};
+
+/// Identifies a SelfReport blob ("LGSR").
+inline constexpr uint32_t kSelfReportMagic = 0x5253474c;
+inline constexpr uint16_t kSelfReportVersion = 1;
+
+/**
+ * @brief Logging overhead over a window, in a fixed binary layout.
+ *
+ * Periodic reports are delivered as blob records tagged "loggable_perf"
+ * whose payload is this struct, little endian, as laid out on the device.
+ * Fields whose source is not built in read 0.
+ */
+struct SelfReport {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;                       ///< sizeof(SelfReport), so older readers can skip new fields.
+    uint32_t window_ms;
+    uint32_t hook_lines;                 ///< Lines whose formatting was timed; needs VOLUME_STATS.
+    uint32_t hook_cycles_p50;            ///< Cycles spent formatting a line.
+    uint32_t hook_cycles_p99;
+    uint16_t drain_busy_permille;        ///< Share of the window the drain task was delivering.
+    uint16_t reserved;
+    uint32_t capture_capacity;
+    uint32_t capture_high_water;         ///< Most bytes queued at once.
+    uint32_t batch_high_water;           ///< Most bytes of the drain batch arena in use at once.
+    uint32_t dropped_lines;              ///< Lines the capture buffer had no room for.
+    uint32_t sinker_p99_us;              ///< From the latency trace, since its last reset.
+    uint32_t record_sinks_p99_us;
+    uint32_t end_to_end_p99_us;
+    uint32_t sinker_bytes_per_second;
+    uint32_t record_sinks_bytes_per_second;
+};
+
+/// Capacity of the per-tag level table of a HookConfig.
+inline constexpr size_t kTagLevelSlots = CONFIG_LOGGABLE_ESPIDF_TAG_LEVEL_SLOTS;
+
+static_assert(kTagLevelSlots != 0 && (kTagLevelSlots & (kTagLevelSlots - 1)) == 0,
+              "LOGGABLE_ESPIDF_TAG_LEVEL_SLOTS must be a power of two");
+
+namespace detail {
+
+/**
+ * @brief 32-bit FNV-1a hash, used to intern tags.
+ */
+constexpr uint32_t fnv1a(std::string_view text) noexcept {
+    uint32_t hash = 2166136261u;
+    for (char c : text) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+    }
+    return hash;
+}
+
+} // namespace detail
+
+/**
+ * @brief Per-tag level ceilings, kept in their lookup form.
+ *
+ * An open-addressed hash table keyed by the FNV-1a hash of the tag, with
+ * linear probing. Tags are not stored: two tags whose hashes collide share
+ * a level. The table is plain data so a configuration can be persisted and
+ * reloaded without rebuilding it.
+ */
+struct TagLevels {
+    uint32_t hashes[kTagLevelSlots];  ///< 0 marks an empty slot.
+    uint8_t levels[kTagLevelSlots];
+    uint16_t count;
+
+    /**
+     * @brief Set the most verbose level a tag may emit.
+     * @return false if the table is full.
+     */
+    bool set(std::string_view tag, esp_log_level_t level) noexcept {
+        const uint32_t hash = key(tag);
+        for (size_t i = 0, slot = hash & (kTagLevelSlots - 1); i < kTagLevelSlots;
+             ++i, slot = (slot + 1) & (kTagLevelSlots - 1)) {
+            if (hashes[slot] == hash || hashes[slot] == 0) {
+                count += hashes[slot] == 0;
+                hashes[slot] = hash;
+                levels[slot] = static_cast<uint8_t>(level);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Look up the level of a tag.
+     * @return The tag's level, or `fallback` if it has none.
+     */
+    esp_log_level_t find(std::string_view tag, esp_log_level_t fallback) const noexcept {
+        const uint32_t hash = key(tag);
+        for (size_t i = 0, slot = hash & (kTagLevelSlots - 1); i < kTagLevelSlots && hashes[slot] != 0;
+             ++i, slot = (slot + 1) & (kTagLevelSlots - 1)) {
+            if (hashes[slot] == hash) {
+                return static_cast<esp_log_level_t>(levels[slot]);
+            }
+        }
+        return fallback;
+    }
+
+    /// Remove every tag.
+    void clear() noexcept { *this = TagLevels{}; }
+
+private:
+    static uint32_t key(std::string_view tag) noexcept {
+        const uint32_t hash = detail::fnv1a(tag);
+        return hash != 0 ? hash : 1;
+    }
+};
+
+/**
+ * @brief Runtime options of the log hook.
+ *
+ * Applied with LogHook::configure() while logging is live. The hook reads
+ * the active configuration with a single load per call, so a new one takes
+ * effect from the next line on without losing anything in flight. Plain
+ * data, so it can be stored and restored as is.
+ *
+ * Level ceilings and the rate limit are ignored by the hook when compiled
+ * out with `LOGGABLE_ESPIDF_HOOK_FILTERS` or `LOGGABLE_ESPIDF_HOOK_RATE_LIMIT`.
+ */
+struct HookConfig {
+    /// Mirror every line to the vprintf handler that was active before install.
+    bool call_original_vprintf = true;
+    /// Queue lines for the drain task; otherwise deliver them on the calling task.
+    bool async_capture = true;
+    /// Deliver records to the Sinker's sinks.
+    bool route_to_sinker = true;
+    /// Deliver records to sinks registered with LogHook::add_record_sink().
+    bool route_to_record_sinks = true;
+    /// Drop lines more verbose than this before they are formatted.
+    esp_log_level_t max_level = ESP_LOG_VERBOSE;
+    /// Lines each task may emit per second, 0 for no limit.
+    uint16_t task_lines_per_second = 0;
+    /// How long a complete record is held for continuation lines, 0 to disable.
+    /// A task's last record before it goes quiet is delivered this much later.
+    uint32_t continuation_window_ms = CONFIG_LOGGABLE_ESPIDF_CONTINUATION_WINDOW_MS;
+    /// Age at which a line still missing its '\n' is flushed as is.
+    uint32_t partial_line_timeout_ms = CONFIG_LOGGABLE_ESPIDF_PARTIAL_LINE_TIMEOUT_MS;
+    /// Drop lines of a tag more verbose than its level here, before they are formatted.
+    TagLevels tag_levels{};
+};
+
+namespace detail {
+
+/**
+ * @brief Read-mostly mirror of the level filters, for LogHook::enabled().
+ *
+ * Statically allocated so readers never chase a pointer that could be
+ * freed; configure() rewrites it under a sequence counter (odd while
+ * writing) and readers retry if it moved. The writer can be preempted by
+ * the reader it is blocking, so readers give up after kLevelIndexAttempts
+ * and ask config_level_enabled() instead. Hashes and levels are kept in
+ * separate arrays so a probe touches one or two cache lines.
+ */
+struct LevelIndex {
+    std::atomic<uint32_t> sequence{0};
+    std::atomic<uint8_t> max_level{ESP_LOG_VERBOSE};
+    std::atomic<uint16_t> tag_count{0};
+    std::atomic<uint32_t> hashes[kTagLevelSlots] = {};
+    std::atomic<uint8_t> levels[kTagLevelSlots] = {};
+};
+
+extern LevelIndex level_index;
+
+/// Reads of level_index before LogHook::enabled() stops waiting for a writer.
+constexpr uint32_t kLevelIndexAttempts = 4;
+
+/// Level and tag part of LogHook::enabled(), read from the active HookConfig while level_index is rewritten.
+bool config_level_enabled(const char* tag, esp_log_level_t level) noexcept;
+
+/// Number of active per-task level filters; see LogHook::set_task_level().
+extern std::atomic<int> task_level_filters;
+
+/// Per-task part of LogHook::enabled(), only called while a task filter is set.
+bool task_level_enabled(esp_log_level_t level) noexcept;
+
+} // namespace detail
+
+/// What a Record's payload holds.
+enum class RecordKind : uint8_t {
+    Text,  ///< A formatted log line.
+    Blob,  ///< Raw bytes of a buffer dump, see BlobFormat.
+};
+
+/// How a blob is rendered as text, mirroring the ESP_LOG_BUFFER_* macros.
+enum class BlobFormat : uint8_t {
+    Hex,      ///< ESP_LOG_BUFFER_HEX: 16 hex bytes per line.
+    Char,     ///< ESP_LOG_BUFFER_CHAR: 16 characters per line.
+    HexDump,  ///< ESP_LOG_BUFFER_HEXDUMP: address, hex and printable columns.
+};
+
+/**
+ * @brief A captured log line together with the task and core that emitted it.
+ *
+ * Views are only valid for the duration of IRecordSink::consume().
+ */
+struct Record {
+    std::chrono::system_clock::time_point timestamp;
+    LogLevel level;
+    std::string_view tag;
+    std::string_view payload;  ///< Line text, or the raw bytes of a blob.
+    const char* task_name;  ///< Interned copy, stays valid after the task is deleted.
+    uint16_t task_id;       ///< Interned task id, unique until the name table wraps.
+    uint8_t core;           ///< Core the line was completed on.
+    RecordKind kind;
+    BlobFormat blob_format;
+    uint32_t blob_address;  ///< Address of the dumped buffer, for hex dumps.
+};
+
+/**
+ * @brief Render a record's payload as text.
+ *
+ * Text records are copied as is; blobs are rendered the way ESP-IDF prints
+ * them, one line per 16 bytes. Sinks that store bytes should use the payload
+ * directly and only call this when they need text.
+ */
+void render_blob(const Record& record, std::string& out);
+
+/**
+ * @brief Sink receiving full records, including producer identity.
+ *
+ * Registered with LogHook::add_record_sink(), alongside the Sinker's sinks.
+ */
+class IRecordSink {
+public:
+    virtual ~IRecordSink() = default;
+    virtual void consume(const Record& record) = 0;
+};
+
 /**
  * @brief ESP-IDF platform adapter for the loggable library.
  *
@@ -23,15 +372,78 @@ public:
      *
      * When installed, all logs made via `ESP_LOGx` macros will be redirected
      * through the loggable Sinker.
+     *
+     * With `LOGGABLE_ESPIDF_PERSIST_CONFIG` enabled the configuration saved
+     * in NVS is applied before the hook goes live.
+     *
+     * @param call_original_vprintf When given, sets
+     *        HookConfig::call_original_vprintf, overriding configure() and
+     *        the saved value; when already installed this only updates the
+     *        option. Omitted, the configured value is kept.
      */
-    static void install(bool call_original_vprintf = true) noexcept;
+    static void install(std::optional<bool> call_original_vprintf = std::nullopt) noexcept;
+
+    /**
+     * @brief Replace the hook's runtime options.
+     *
+     * Takes effect without reinstalling: the Sinker and the capture buffer
+     * keep running and no line is lost. May be called before install() and
+     * from a sink.
+     *
+     * @return false if the new configuration could not be allocated.
+     */
+    static bool configure(const HookConfig& config) noexcept;
+
+    /**
+     * @brief Get a copy of the active runtime options.
+     */
+    [[nodiscard]] static HookConfig config() noexcept;
+
+    /**
+     * @brief Persist the active configuration and default task level to NVS.
+     *
+     * Stored as one versioned blob under `CONFIG_LOGGABLE_ESPIDF_NVS_NAMESPACE`,
+     * tag table included, so it is restored with a single read. NVS must
+     * have been initialized with `nvs_flash_init()`.
+     *
+     * @return false if NVS could not be written.
+     */
+    static bool save_config() noexcept;
+
+    /**
+     * @brief Apply the configuration saved by save_config().
+     *
+     * With `LOGGABLE_ESPIDF_PERSIST_CONFIG` enabled, install() calls this
+     * before it returns, so the first captured line is already filtered.
+     *
+     * @return false if there is no saved configuration, or it was written
+     *         by an incompatible version and was ignored.
+     */
+    static bool load_config() noexcept;
+
+    /**
+     * @brief Remove the saved configuration from NVS.
+     */
+    static bool erase_saved_config() noexcept;
 
     /**
      * @brief Uninstall the ESP-IDF log hook.
      *
-     * Restores the original vprintf handler.
+     * Restores the original vprintf handler, then waits up to
+     * `CONFIG_LOGGABLE_ESPIDF_QUIESCE_TIMEOUT_MS` for hook calls still in
+     * flight on other tasks before stopping the capture pipeline and the
+     * Sinker. Calls arriving after the swap are forwarded to the original
+     * handler. Safe to call, and to follow with install(), under full
+     * logging load.
+     *
+     * @return false if calls were still in flight at the timeout; the
+     *         pipeline is then left running and the next uninstall() or
+     *         install() picks it up.
+     * @note Returned void before the wait was added. Callers that ignore
+     *       the result still compile; they should check it before tearing
+     *       down anything the hook's sinks use.
      */
-    static void uninstall() noexcept;
+    static bool uninstall() noexcept;
 
     /**
      * @brief Check if the hook is currently installed.
@@ -39,7 +451,225 @@ public:
      */
     [[nodiscard]] static bool is_installed() noexcept;
 
+    /**
+     * @brief Check whether the hook would keep a line, without logging it.
+     *
+     * Applies the global and per-tag ceilings of the active HookConfig and
+     * the calling task's level, so callers can skip computing arguments of
+     * lines that would be dropped. Inline, lock free and allocation free:
+     * a sequence counter read, a compare and, with tag levels configured, a
+     * hash and a short probe. While configure() is rewriting the index it
+     * reads the configuration out of line rather than wait. ESP-IDF's own `esp_log_level_set()` levels are
+     * not consulted.
+     *
+     * @param tag Tag as passed to `ESP_LOGx`; may be nullptr.
+     */
+    [[nodiscard]] static bool enabled(const char* tag, esp_log_level_t level) noexcept {
+        const detail::LevelIndex& index = detail::level_index;
+        bool allowed;
+        for (uint32_t attempt = 1;; ++attempt) {
+            const uint32_t sequence = index.sequence.load(std::memory_order_acquire);
+            allowed = level <= index.max_level.load(std::memory_order_relaxed);
+            if (allowed && tag && index.tag_count.load(std::memory_order_relaxed) != 0) {
+                allowed = level <= tag_level(index, tag);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if ((sequence & 1) == 0 && sequence == index.sequence.load(std::memory_order_relaxed)) [[likely]] {
+                break;
+            }
+            if (attempt == detail::kLevelIndexAttempts) {
+                allowed = detail::config_level_enabled(tag, level);
+                break;
+            }
+        }
+
+        if (allowed && detail::task_level_filters.load(std::memory_order_relaxed) != 0) [[unlikely]] {
+            allowed = detail::task_level_enabled(level);
+        }
+        return allowed;
+    }
+
+    /**
+     * @brief Override the log level of a single task.
+     *
+     * Lines from the task that are more verbose than `level` are dropped by
+     * the hook before being formatted. ESP-IDF still applies its per-tag
+     * levels first, so making one task more verbose than the rest means
+     * raising the tag level with `esp_log_level_set` and lowering the others
+     * with set_default_task_level().
+     *
+     * @param task Task handle, or nullptr for the calling task.
+     * @param level Most verbose level the task may emit.
+     * @return false if the task state could not be allocated.
+     */
+    static bool set_task_level(TaskHandle_t task, esp_log_level_t level) noexcept;
+
+    /**
+     * @brief Override the log level of a task looked up by name.
+     * @return false if no task has this name.
+     */
+    static bool set_task_level(const char* task_name, esp_log_level_t level) noexcept;
+
+    /**
+     * @brief Remove the level override of a task.
+     */
+    static bool clear_task_level(TaskHandle_t task) noexcept;
+
+    /**
+     * @brief Remove the level override of a task looked up by name.
+     * @return false if no task has this name.
+     */
+    static bool clear_task_level(const char* task_name) noexcept;
+
+    /**
+     * @brief Set the level applied to tasks without an override.
+     *
+     * Defaults to `ESP_LOG_VERBOSE`, which leaves filtering to ESP-IDF.
+     */
+    static void set_default_task_level(esp_log_level_t level) noexcept;
+
+    /**
+     * @brief Get the log volume accounted since the last reset.
+     *
+     * Lines, formatted bytes and formatting cycles are charged to the
+     * emitting task and to the line's tag. The report is returned by value
+     * and holds two tables of kVolumeSlots entries; mind the caller's stack.
+     *
+     * @param reset Start a new accounting window after reading.
+     */
+    [[nodiscard]] static VolumeReport volume_report(bool reset = false) noexcept;
+
+    /**
+     * @brief Emit a volume report every `interval_ms` and reset the window.
+     *
+     * Without a callback the report is delivered as a blob record tagged
+     * "loggable_volume" whose payload is the VolumeReport, as laid out on
+     * the device, with entries past `top_n` zeroed. Record sinks receive
+     * the bytes; the Sinker gets them rendered as hex.
+     *
+     * @param top_n Number of tasks and tags to include.
+     * @return false if the report timer could not be started.
+     */
+    static bool start_volume_reports(uint32_t interval_ms, size_t top_n = kVolumeSlots,
+                                     VolumeReportCallback callback = nullptr, void* user = nullptr) noexcept;
+
+    /**
+     * @brief Stop periodic volume reports.
+     */
+    static void stop_volume_reports() noexcept;
+
+    /**
+     * @brief Get the logging overhead measured since the last reset.
+     *
+     * All zero unless built with CONFIG_LOGGABLE_ESPIDF_SELF_REPORT.
+     *
+     * @param reset Start a new window after reading.
+     */
+    [[nodiscard]] static SelfReport self_report(bool reset = false) noexcept;
+
+    /**
+     * @brief Emit a SelfReport into the pipeline every `interval_ms` and
+     *        reset the window.
+     * @return false if self-reports are not built in or the timer could
+     *         not be started.
+     */
+    static bool start_self_reports(uint32_t interval_ms) noexcept;
+
+    /**
+     * @brief Stop periodic self-reports.
+     */
+    static void stop_self_reports() noexcept;
+
+    /**
+     * @brief Get the heap allocations counted since the last reset.
+     *
+     * All zero unless built with CONFIG_LOGGABLE_ESPIDF_ALLOC_COUNTERS.
+     *
+     * @param reset Start a new window after reading, e.g. after warm-up.
+     */
+    [[nodiscard]] static AllocationReport allocation_report(bool reset = false) noexcept;
+
+    /**
+     * @brief Check the allocations since the last reset against a budget.
+     *
+     * Meant for steady-state checks: reset after warm-up, run representative
+     * traffic, then check. A path with no lines passes.
+     *
+     * @param report Receives the counts that were checked, if not null.
+     * @return false if either path allocated more than its budget per line,
+     *         or if allocations are not counted in this build.
+     */
+    static bool within_allocation_budget(const AllocationBudget& budget, AllocationReport* report = nullptr) noexcept;
+
+    /**
+     * @brief Get the per-stage line latencies measured since the last reset.
+     *
+     * All zero unless built with CONFIG_LOGGABLE_ESPIDF_LATENCY_TRACE.
+     *
+     * @param reset Start a new window after reading.
+     */
+    [[nodiscard]] static LatencyReport latency_report(bool reset = false) noexcept;
+
+    /**
+     * @brief Dispatch the latency report through the Sinker as an Info
+     *        record tagged "loggable".
+     */
+    static void dump_latency_report(bool reset = false) noexcept;
+
+    /**
+     * @brief Capture a buffer as a single binary record.
+     *
+     * The bytes are copied once and delivered verbatim to record sinks; they
+     * are only rendered as hex for the Sinker's text sinks and the console.
+     * With `LOGGABLE_ESPIDF_CAPTURE_BUFFER_DUMPS` enabled the
+     * `ESP_LOG_BUFFER_HEX/CHAR/HEXDUMP` macros are routed here.
+     */
+    static void log_buffer(const char* tag, const void* data, size_t length, esp_log_level_t level,
+                           BlobFormat format = BlobFormat::HexDump) noexcept;
+
+    /**
+     * @brief Check whether the memory governor is in low-memory mode.
+     *
+     * With `LOGGABLE_ESPIDF_MEMORY_GOVERNOR` the drain task watches the free
+     * internal heap. Below `LOGGABLE_ESPIDF_GOVERNOR_LOW_WATERMARK`, or after
+     * a failed allocation, it drops Debug and Verbose lines, frees spare
+     * buffers and shrinks the capture buffer to a quarter, and undoes this
+     * above `LOGGABLE_ESPIDF_GOVERNOR_HIGH_WATERMARK`. Each transition is
+     * reported as a record tagged "loggable".
+     */
+    [[nodiscard]] static bool under_memory_pressure() noexcept;
+
+    /**
+     * @brief Register a sink that receives records with task and core identity.
+     *
+     * Safe while logging is live: dispatch reads an immutable snapshot of the
+     * sink list without locking, and the previous snapshot is freed once no
+     * dispatch can still be using it. May be called from a sink's consume().
+     */
+    static void add_record_sink(std::shared_ptr<IRecordSink> sink) noexcept;
+
+    /**
+     * @brief Unregister a record sink.
+     */
+    static void remove_record_sink(const std::shared_ptr<IRecordSink>& sink) noexcept;
+
 private:
+    static uint8_t tag_level(const detail::LevelIndex& index, std::string_view tag) noexcept {
+        uint32_t hash = detail::fnv1a(tag);
+        hash = hash != 0 ? hash : 1;
+        for (size_t i = 0, slot = hash & (kTagLevelSlots - 1); i < kTagLevelSlots;
+             ++i, slot = (slot + 1) & (kTagLevelSlots - 1)) {
+            const uint32_t probe = index.hashes[slot].load(std::memory_order_relaxed);
+            if (probe == hash) {
+                return index.levels[slot].load(std::memory_order_relaxed);
+            }
+            if (probe == 0) {
+                break;
+            }
+        }
+        return ESP_LOG_VERBOSE;
+    }
+
     static std::atomic<bool> _installed;
 };
 
@@ -0,0 +1,257 @@
+#pragma once
+
+#include "loggable_espidf.hpp"
+#include <esp_log.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#ifndef CONFIG_LOGGABLE_ESPIDF_FORMAT_ARGS_SIZE
+#define CONFIG_LOGGABLE_ESPIDF_FORMAT_ARGS_SIZE 128
+#endif
+
+namespace loggable {
+namespace espidf {
+
+/// Type of one serialized argument of a formatted record.
+enum class ArgType : uint8_t {
+    Bool,
+    Char,
+    Int,
+    UInt,
+    Int64,
+    UInt64,
+    Double,
+    String,   ///< uint16_t length followed by the bytes, no terminator.
+    Pointer,
+};
+
+namespace detail {
+
+/// Not constexpr: reaching it during constant evaluation is the compile error.
+inline void format_error(const char*) {}
+
+/**
+ * @brief Validate a format string against an argument count.
+ *
+ * Accepts `{}` and `{:spec}` placeholders, where spec is an optional
+ * `.precision` followed by an optional `x`, `X` or `f`, and `{{` / `}}` as
+ * literal braces.
+ */
+consteval void check_format(std::string_view format, size_t arg_count) {
+    size_t placeholders = 0;
+    for (size_t i = 0; i < format.size(); ++i) {
+        if (format[i] == '}') {
+            if (i + 1 >= format.size() || format[i + 1] != '}') {
+                format_error("unmatched '}' in format string");
+            }
+            ++i;
+            continue;
+        }
+        if (format[i] != '{') {
+            continue;
+        }
+        if (i + 1 < format.size() && format[i + 1] == '{') {
+            ++i;
+            continue;
+        }
+        size_t j = i + 1;
+        if (j < format.size() && format[j] == ':') {
+            ++j;
+            if (j < format.size() && format[j] == '.') {
+                ++j;
+                while (j < format.size() && format[j] >= '0' && format[j] <= '9') {
+                    ++j;
+                }
+            }
+            if (j < format.size() && (format[j] == 'x' || format[j] == 'X' || format[j] == 'f')) {
+                ++j;
+            }
+        }
+        if (j >= format.size() || format[j] != '}') {
+            format_error("unsupported or unterminated placeholder in format string");
+        }
+        ++placeholders;
+        i = j;
+    }
+    if (placeholders != arg_count) {
+        format_error("format string placeholders do not match the argument count");
+    }
+}
+
+template <typename T>
+constexpr ArgType arg_type() {
+    using U = std::remove_cv_t<std::remove_reference_t<T>>;
+    if constexpr (std::is_same_v<U, bool>) {
+        return ArgType::Bool;
+    } else if constexpr (std::is_same_v<U, char>) {
+        return ArgType::Char;
+    } else if constexpr (std::is_integral_v<U> || std::is_enum_v<U>) {
+        if constexpr (sizeof(U) <= 4) {
+            return std::is_signed_v<U> ? ArgType::Int : ArgType::UInt;
+        } else {
+            return std::is_signed_v<U> ? ArgType::Int64 : ArgType::UInt64;
+        }
+    } else if constexpr (std::is_floating_point_v<U>) {
+        return ArgType::Double;
+    } else if constexpr (std::is_null_pointer_v<U>) {
+        // Converts to const char*, but there is no string to copy.
+        return ArgType::Pointer;
+    } else if constexpr (std::is_convertible_v<const U&, std::string_view>) {
+        return ArgType::String;
+    } else if constexpr (std::is_pointer_v<std::decay_t<U>>) {
+        return ArgType::Pointer;
+    } else {
+        static_assert(sizeof(U) == 0, "unsupported argument type for loggable::espidf::log");
+    }
+}
+
+/// Bounded writer of serialized arguments; truncates strings that do not fit.
+class ArgWriter {
+public:
+    template <typename T>
+    void write(const T& value) noexcept {
+        constexpr ArgType type = arg_type<T>();
+        if constexpr (type == ArgType::String) {
+            std::string_view text;
+            if constexpr (std::is_pointer_v<T>) {
+                // printf prints "(null)" for a null %s; string_view would be UB.
+                text = value ? std::string_view(value) : std::string_view("(null)");
+            } else {
+                text = std::string_view(value);
+            }
+            if (!reserve(1 + sizeof(uint16_t))) {
+                return;
+            }
+            const size_t room = sizeof(_data) - _size - 1 - sizeof(uint16_t);
+            const uint16_t length = static_cast<uint16_t>(text.size() < room ? text.size() : room);
+            put(type, &length, sizeof(length));
+            std::memcpy(_data + _size, text.data(), length);
+            _size += length;
+        } else if constexpr (type == ArgType::Double) {
+            const double converted = static_cast<double>(value);
+            put_checked(type, &converted, sizeof(converted));
+        } else if constexpr (type == ArgType::Pointer) {
+            uintptr_t converted = 0;
+            if constexpr (!std::is_null_pointer_v<T>) {
+                converted = reinterpret_cast<uintptr_t>(value);
+            }
+            put_checked(type, &converted, sizeof(converted));
+        } else if constexpr (type == ArgType::Int64 || type == ArgType::UInt64) {
+            const uint64_t converted = static_cast<uint64_t>(value);
+            put_checked(type, &converted, sizeof(converted));
+        } else {
+            const uint32_t converted = static_cast<uint32_t>(value);
+            put_checked(type, &converted, sizeof(converted));
+        }
+    }
+
+    const uint8_t* data() const noexcept { return _data; }
+    size_t size() const noexcept { return _size; }
+
+private:
+    bool reserve(size_t size) const noexcept { return _size + size <= sizeof(_data); }
+
+    void put(ArgType type, const void* value, size_t size) noexcept {
+        _data[_size++] = static_cast<uint8_t>(type);
+        std::memcpy(_data + _size, value, size);
+        _size += size;
+    }
+
+    void put_checked(ArgType type, const void* value, size_t size) noexcept {
+        if (reserve(1 + size)) {
+            put(type, value, size);
+        }
+    }
+
+    uint8_t _data[CONFIG_LOGGABLE_ESPIDF_FORMAT_ARGS_SIZE];
+    size_t _size = 0;
+};
+
+/**
+ * @brief Hand a serialized record to the capture pipeline.
+ *
+ * Defined in loggable_espidf_format.cpp.
+ */
+void emit_formatted(esp_log_level_t level, const char* tag, const char* format, const uint8_t* args,
+                    size_t size) noexcept;
+
+/**
+ * @brief Render a format string with serialized arguments.
+ *
+ * Arguments that were cut off by the size limit render as `{?}`.
+ */
+void format_args(std::string_view format, const uint8_t* args, size_t size, std::string& out);
+
+} // namespace detail
+
+/**
+ * @brief Format string checked against its arguments at compile time.
+ *
+ * Holds a pointer to the literal, which outlives the record; the text is
+ * only parsed again when the drain task formats the record.
+ */
+template <typename... Args>
+class FormatString {
+public:
+    template <size_t N>
+    consteval FormatString(const char (&text)[N]) : _text(text) {
+        detail::check_format(std::string_view(text, N - 1), sizeof...(Args));
+    }
+
+    constexpr const char* c_str() const noexcept { return _text; }
+
+private:
+    const char* _text;
+};
+
+/**
+ * @brief Log a fmt-style line through the hook's capture pipeline.
+ *
+ * The format string is checked at compile time and the arguments are
+ * serialized with their static types; the line is only formatted to text
+ * by the drain task. Honours LogHook::enabled() and ESP-IDF's level of the
+ * tag. Strings are copied, up to `CONFIG_LOGGABLE_ESPIDF_FORMAT_ARGS_SIZE`
+ * bytes of arguments in total.
+ */
+template <typename... Args>
+void log(esp_log_level_t level, const char* tag, FormatString<std::type_identity_t<Args>...> format,
+         const Args&... args) noexcept {
+    if (!LogHook::enabled(tag, level)) {
+        return;
+    }
+    detail::ArgWriter writer;
+    (writer.write(args), ...);
+    detail::emit_formatted(level, tag, format.c_str(), writer.data(), writer.size());
+}
+
+template <typename... Args>
+void log_error(const char* tag, FormatString<std::type_identity_t<Args>...> format, const Args&... args) noexcept {
+    log<Args...>(ESP_LOG_ERROR, tag, format, args...);
+}
+
+template <typename... Args>
+void log_warn(const char* tag, FormatString<std::type_identity_t<Args>...> format, const Args&... args) noexcept {
+    log<Args...>(ESP_LOG_WARN, tag, format, args...);
+}
+
+template <typename... Args>
+void log_info(const char* tag, FormatString<std::type_identity_t<Args>...> format, const Args&... args) noexcept {
+    log<Args...>(ESP_LOG_INFO, tag, format, args...);
+}
+
+template <typename... Args>
+void log_debug(const char* tag, FormatString<std::type_identity_t<Args>...> format, const Args&... args) noexcept {
+    log<Args...>(ESP_LOG_DEBUG, tag, format, args...);
+}
+
+template <typename... Args>
+void log_verbose(const char* tag, FormatString<std::type_identity_t<Args>...> format, const Args&... args) noexcept {
+    log<Args...>(ESP_LOG_VERBOSE, tag, format, args...);
+}
+
+} // namespace espidf
+} // namespace loggable
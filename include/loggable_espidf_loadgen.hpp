@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace loggable {
+namespace espidf {
+
+/// Most producer tasks a load run may spawn.
+inline constexpr size_t kMaxLoadTasks = 16;
+
+/// Most distinct tags a load run cycles through.
+inline constexpr size_t kMaxLoadTags = 16;
+
+/// Longest message body a load run emits.
+inline constexpr size_t kMaxLoadLineLength = 192;
+
+/**
+ * @brief Shape of a synthetic log storm.
+ *
+ * Every choice a producer makes (tag, level, length, split, burst) comes
+ * from a xorshift generator seeded with `seed` plus the task index, so two
+ * runs of the same profile on the same build emit the same lines.
+ */
+struct LoadProfile {
+    uint32_t seed = 1;
+    size_t tasks = 1;                 ///< Producers.
+    bool pinned = true;               ///< Pin producer i to core i % cores, else let the scheduler place them.
+    uint32_t duration_ms = 2000;
+    uint32_t lines_per_second = 0;    ///< Per task; 0 emits as fast as possible.
+    size_t tag_count = 4;             ///< Tags "load0".."loadN-1", at most kMaxLoadTags.
+    uint8_t level_weights[5] = {1, 2, 8, 2, 1};  ///< Relative odds of E, W, I, D, V.
+    size_t min_line_length = 16;      ///< Message body length, excluding the header.
+    size_t max_line_length = 96;      ///< At most kMaxLoadLineLength.
+    uint8_t partial_percent = 0;      ///< Lines emitted as two writes, split mid-body.
+    uint8_t burst_percent = 0;        ///< Chance per line of starting a burst instead.
+    uint16_t burst_lines = 32;        ///< Lines in a burst, emitted without pacing.
+    uint16_t yield_lines = 256;       ///< Full speed only: lines between one-tick delays.
+    uint32_t stack_size = 3072;
+    uint32_t priority = 1;            ///< Below the drain task, so the Sinker keeps up if it can.
+};
+
+/**
+ * @brief Outcome of one load run.
+ *
+ * Latencies are CPU cycles spent in the producer's log call, from entering
+ * esp_log_write() to its return, for whole lines (both writes of a split
+ * line). Levels above the runtime ESP-IDF level are discarded before the
+ * hook and still count as lines.
+ */
+struct LoadResult {
+    size_t tasks;
+    uint32_t duration_ms;        ///< Measured, from the first producer start to the last finish.
+    uint32_t lines;
+    uint32_t lines_per_second;
+    uint32_t dropped_lines;      ///< Lines the capture buffer had no room for.
+    uint32_t latency_p50;
+    uint32_t latency_p90;
+    uint32_t latency_p99;
+    uint32_t latency_p999;
+    uint32_t latency_max;
+    uint32_t allocations;        ///< On the hook and delivery paths; needs ALLOC_COUNTERS.
+    uint32_t peak_capture_bytes; ///< Capture buffer high-water mark.
+    uint32_t lock_acquisitions;  ///< Of the capture buffer lock, producers and drain task; needs LOCK_COUNTERS.
+    uint32_t lock_contentions;   ///< Acquisitions that had to wait for another holder.
+};
+
+/// Metrics compared against a baseline; bits of compare()'s result.
+enum LoadMetric : uint32_t {
+    kLoadThroughput = 1u << 0,   ///< lines_per_second, higher is better.
+    kLoadLatencyP50 = 1u << 1,   ///< Cycles per line, typical.
+    kLoadLatencyP99 = 1u << 2,   ///< Cycles per line, tail.
+    kLoadAllocations = 1u << 3,  ///< Allocations per line.
+    kLoadPeakMemory = 1u << 4,   ///< peak_capture_bytes.
+    kLoadDrops = 1u << 5,        ///< Any drop where the baseline had none.
+};
+
+/// Noise tolerated before a metric counts as regressed, in percent of the baseline.
+struct LoadThresholds {
+    uint8_t throughput_percent = 5;
+    uint8_t latency_percent = 10;
+    uint8_t allocations_percent = 0;
+    uint8_t memory_percent = 10;
+};
+
+/**
+ * @brief Deterministic synthetic log storm for load and scaling tests.
+ *
+ * Drives the installed hook through the regular ESP_LOGx path. Built only
+ * with CONFIG_LOGGABLE_ESPIDF_LOAD_GENERATOR; otherwise runs fail, while
+ * to_json(), from_json() and compare() remain available for results from
+ * elsewhere. from_json() and compare() depend on nothing but the standard
+ * library, so host tools build them to check results against baselines.
+ */
+class LoadGenerator {
+public:
+    /**
+     * @brief Run one profile to completion, blocking the caller.
+     *
+     * Waits for the capture buffer to drain first, so runs do not inherit
+     * each other's backlog.
+     *
+     * @return false if the profile is invalid or not every producer started;
+     *         `result` then covers the producers that did.
+     */
+    static bool run(const LoadProfile& profile, LoadResult& result) noexcept;
+
+    /**
+     * @brief Find where throughput stops scaling with producers.
+     *
+     * Runs `profile` with 1, 2, 4, ... tasks up to `max_tasks`, stopping at
+     * the first step that drops lines or adds less than 5% throughput.
+     *
+     * @param results Receives one entry per step; the last is the saturation point.
+     * @return Number of entries written.
+     */
+    static size_t find_saturation(const LoadProfile& profile, size_t max_tasks, LoadResult* results,
+                                  size_t max_results) noexcept;
+
+    /**
+     * @brief Render a result as one JSON object, with the profile and the
+     *        build environment (ESP-IDF version, target, cores, CPU clock,
+     *        capture buffer size) for comparing runs across builds.
+     * @return Length of the full document, as snprintf(); output is
+     *         truncated if that is not below `size`.
+     */
+    static size_t to_json(const LoadProfile& profile, const LoadResult& result, char* out, size_t size) noexcept;
+
+    /**
+     * @brief Read back a document written by to_json().
+     *
+     * Profile fields to_json() does not write keep their defaults; the
+     * environment is skipped.
+     *
+     * @return false, leaving the outputs alone, if a profile or metrics
+     *         field is missing or out of range.
+     */
+    static bool from_json(std::string_view json, LoadProfile& profile, LoadResult& result) noexcept;
+
+    /**
+     * @brief Compare a result with a baseline of the same profile.
+     *
+     * Baselines are LoadResult values kept by the application, e.g. from a
+     * known good build, or read with from_json(). A baseline of zero for
+     * throughput, a latency or peak memory means the metric was not
+     * recorded and is skipped; zero allocations or drops is a budget that
+     * any allocation or drop breaks.
+     *
+     * @return LoadMetric bits of every metric worse than the baseline by
+     *         more than its threshold; 0 if none regressed.
+     */
+    static uint32_t compare(const LoadResult& baseline, const LoadResult& current,
+                            const LoadThresholds& thresholds = {}) noexcept;
+};
+
+} // namespace espidf
+} // namespace loggable
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <string_view>
+
+namespace loggable {
+namespace espidf {
+
+/// Receives consecutive chunks of an exported trace.
+using TraceWriter = void (*)(std::string_view chunk, void* user);
+
+/**
+ * @brief Timeline of the logging pipeline for chrome://tracing.
+ *
+ * While started, the hook, drain wakeups, batch delivery, the record
+ * sinks and the Sinker record begin/end events with microsecond
+ * timestamps into a fixed ring per core. Writers never block or allocate;
+ * when a ring wraps its oldest events are overwritten. Sinks can add
+ * their own spans, e.g. a flash erase, with begin()/end() or
+ * PipelineTraceScope. Built only with CONFIG_LOGGABLE_ESPIDF_TRACE_EVENTS;
+ * otherwise nothing is recorded.
+ */
+class PipelineTrace {
+public:
+    /// Clear the rings and start recording.
+    static void start() noexcept;
+    static void stop() noexcept;
+
+    static bool active() noexcept { return _active.load(std::memory_order_relaxed); }
+
+    /// @param name String with static storage duration; only the pointer is kept.
+    static void begin(const char* name) noexcept {
+        if (active()) {
+            record(name, 'B');
+        }
+    }
+
+    static void end(const char* name) noexcept {
+        if (active()) {
+            record(name, 'E');
+        }
+    }
+
+    /// A point in time rather than a span.
+    static void instant(const char* name) noexcept {
+        if (active()) {
+            record(name, 'i');
+        }
+    }
+
+    /**
+     * @brief Write the recorded events as Chrome trace event JSON.
+     *
+     * Events are filed under one process, with each task a thread named
+     * after it, so a span whose task migrated between begin and end still
+     * pairs up; the core that recorded an event is in its args.
+     * Best called after stop(); events being written during the export are
+     * skipped.
+     *
+     * @return false if tracing is not built in.
+     */
+    static bool export_chrome_json(TraceWriter writer, void* user) noexcept;
+
+private:
+    static void record(const char* name, char phase) noexcept;
+
+    static std::atomic<bool> _active;
+};
+
+/// Records a span for the lifetime of the scope.
+class PipelineTraceScope {
+public:
+    explicit PipelineTraceScope(const char* name) noexcept : _name(name) { PipelineTrace::begin(name); }
+    ~PipelineTraceScope() { PipelineTrace::end(_name); }
+
+    PipelineTraceScope(const PipelineTraceScope&) = delete;
+    PipelineTraceScope& operator=(const PipelineTraceScope&) = delete;
+
+private:
+    const char* _name;
+};
+
+} // namespace espidf
+} // namespace loggable
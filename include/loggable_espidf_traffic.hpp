@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace loggable {
+namespace espidf {
+
+/// Identifies a traffic trace ("LGTR").
+inline constexpr uint32_t kTrafficTraceMagic = 0x5254474c;
+inline constexpr uint16_t kTrafficTraceVersion = 1;
+
+/**
+ * @brief Start of a traffic trace.
+ *
+ * Followed by `records` TrafficRecord entries, each followed by its output
+ * and padded to a multiple of 4 bytes. All fields are little endian, as
+ * written by the device.
+ */
+struct TrafficTraceHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;   ///< sizeof(TrafficTraceHeader), to skip fields added later.
+    uint32_t size;          ///< Whole trace in bytes, header included.
+    uint32_t records;
+    uint32_t dropped;       ///< Invocations that did not fit the buffer.
+};
+
+/// One hook invocation.
+struct TrafficRecord {
+    uint32_t time_us;       ///< Since the recording started.
+    uint32_t format;        ///< Address of the format string, identifying the call site.
+    uint16_t task_id;       ///< Interned task id; names are not recorded.
+    uint16_t length;        ///< Bytes of formatted output that follow.
+};
+
+/// Totals of a replay.
+struct ReplayResult {
+    uint32_t records;
+    uint32_t duration_ms;
+    uint32_t lines_per_second;  ///< Records per second, split lines counting once per part.
+};
+
+/**
+ * @brief Records every hook invocation for offline benchmarking.
+ *
+ * While recording, each invocation that passes the hook's filters appends
+ * its timestamp, task, format string address and formatted output to a
+ * preallocated buffer; nothing else changes. When the buffer is full
+ * further invocations are only counted. Built only with
+ * CONFIG_LOGGABLE_ESPIDF_TRAFFIC_RECORDER; otherwise start() fails.
+ */
+class TrafficRecorder {
+public:
+    /**
+     * @brief Allocate a trace buffer and start recording, discarding any
+     *        previous trace.
+     * @param capacity Buffer size in bytes, header included.
+     */
+    static bool start(size_t capacity) noexcept;
+
+    /**
+     * @brief Stop recording and wait for invocations still writing.
+     *
+     * Must not be called from a sink.
+     *
+     * @return false if writers did not finish within the quiesce timeout;
+     *         call again before reading the trace.
+     */
+    static bool stop() noexcept;
+
+    static bool recording() noexcept;
+
+    /**
+     * @brief The finished trace, valid until start() or release().
+     * @return An empty view while recording or if nothing was recorded.
+     */
+    static std::string_view trace() noexcept;
+
+    /// Free the trace buffer.
+    static void release() noexcept;
+};
+
+/**
+ * @brief Feed a trace through the installed hook.
+ *
+ * Every record is written with esp_log_write() from the calling task, so
+ * it takes the full capture and Sinker path and is mirrored to the console
+ * if the hook does. Records are written under the level and tag of their
+ * recorded header, through a literal header format like `ESP_LOGx`, so
+ * level filters, tag statistics and rate limits see them as they saw the
+ * live traffic; continuations of split lines reuse the last header's. Partial
+ * lines of different recorded tasks that interleave are joined, since they
+ * all come from one task now.
+ *
+ * @param speedup 1 replays at the recorded pace, N at N times that, and 0
+ *                as fast as possible.
+ * @return false if the trace is malformed; records before the fault were replayed.
+ */
+bool replay_traffic(std::string_view trace, uint32_t speedup, ReplayResult* result = nullptr) noexcept;
+
+} // namespace espidf
+} // namespace loggable
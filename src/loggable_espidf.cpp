@@ -1,13 +1,29 @@
 #include "loggable_espidf.hpp"
 #include "loggable.hpp"
+#include "loggable_espidf_alloc.hpp"
+#include "loggable_espidf_capture.hpp"
+#include "loggable_espidf_config.hpp"
+#include "loggable_espidf_governor.hpp"
+#include "loggable_espidf_rcu.hpp"
+#include "loggable_espidf_recorder.hpp"
+#include "loggable_espidf_report.hpp"
+#include "loggable_espidf_stats.hpp"
+#include "loggable_espidf_task.hpp"
+#include "loggable_espidf_trace.hpp"
 #include "loggable_os.hpp"
 #include <esp_log.h>
+#include <algorithm>
+#include <array>
 #include <charconv>
 #include <cstdarg>
 #include <cstdio>
+#include <iterator>
 #include <mutex>
+#include <new>
 #include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 namespace loggable {
 
@@ -19,17 +35,103 @@ namespace espidf {
 
 namespace {
 
-static bool _call_original_vprintf = true;
-static vprintf_like_t original_vprintf = nullptr;
+// Kept after uninstall so calls that raced with it can still forward.
+static std::atomic<vprintf_like_t> original_vprintf{nullptr};
 static std::mutex hook_mutex;
+static bool shutdown_pending = false;
 
-struct ThreadBufferState {
-    std::string log_buffer;
+/// Optional stages of the hook; each variant is compiled with a subset.
+enum HookFeature : uint32_t {
+    kMirror = 1u << 0,       ///< Copy lines to the original vprintf.
+    kFilter = 1u << 1,       ///< Global and per-tag level ceilings.
+    kRateLimit = 1u << 2,    ///< Per-task lines per second.
 };
+inline constexpr uint32_t kHookFeatureCount = 3;
 
-static ThreadBufferState& get_thread_buffer() {
-    static thread_local ThreadBufferState buffer_state;
-    return buffer_state;
+/// Features built into this image; the others are compiled out of every variant.
+inline constexpr uint32_t kCompiledFeatures = kMirror
+                                              | (CONFIG_LOGGABLE_ESPIDF_HOOK_FILTERS ? kFilter : 0u)
+                                              | (CONFIG_LOGGABLE_ESPIDF_HOOK_RATE_LIMIT ? kRateLimit : 0u);
+
+// Serializes esp_log_set_vprintf() between install, uninstall and
+// configure(), which swaps variants while installed.
+static std::mutex hook_swap_mutex;
+static vprintf_like_t active_hook = nullptr;
+
+/// Immutable snapshot of the registered record sinks.
+struct SinkList {
+    std::vector<std::shared_ptr<IRecordSink>> sinks;
+};
+
+// Dispatch reads the current snapshot inside an RCU read section; add and
+// remove publish a copy and free the old one after a grace period. Writers
+// are serialized by record_sinks_mutex, which dispatch never takes.
+static detail::RcuDomain record_sinks_rcu;
+static std::atomic<const SinkList*> record_sinks{nullptr};
+static std::mutex record_sinks_mutex;
+static std::vector<const SinkList*> retired_sink_lists;
+static std::atomic<bool> sink_lists_retired{false};
+
+void consume_record(const Record& record) {
+    if (!record_sinks.load(std::memory_order_relaxed)) {
+        return;
+    }
+    detail::RcuReadGuard guard(record_sinks_rcu);
+    if (const SinkList* list = record_sinks.load(std::memory_order_acquire)) {
+        for (const auto& sink : list->sinks) {
+            sink->consume(record);
+        }
+    }
+}
+
+/// Marks the calling task as dispatching to sinks, which may call back into the hook's API.
+class DispatchScope {
+public:
+    DispatchScope() noexcept : _ctx(detail::get_task_context()) {
+        if (!_ctx || _ctx->sink_dispatch_depth == 0) {
+            detail::count_delivery();
+        }
+        if (_ctx) {
+            ++_ctx->sink_dispatch_depth;
+        }
+    }
+    ~DispatchScope() {
+        if (_ctx) {
+            --_ctx->sink_dispatch_depth;
+        }
+    }
+
+    DispatchScope(const DispatchScope&) = delete;
+    DispatchScope& operator=(const DispatchScope&) = delete;
+
+private:
+    detail::TaskContext* _ctx;
+};
+
+/// Free retired snapshots once no reader can see them. Called with record_sinks_mutex held.
+void reclaim_sink_lists() {
+    const detail::TaskContext* ctx = detail::find_task_context();
+    if (retired_sink_lists.empty() || (ctx && ctx->sink_dispatch_depth != 0)) {
+        // A sink changing the registry from consume() is itself a reader;
+        // waiting here would never end, so reclamation is left to the next
+        // writer or the drain task.
+        return;
+    }
+    record_sinks_rcu.synchronize();
+    for (const SinkList* list : retired_sink_lists) {
+        delete list;
+    }
+    retired_sink_lists.clear();
+    sink_lists_retired.store(false, std::memory_order_relaxed);
+}
+
+/// Publish a new snapshot. Called with record_sinks_mutex held.
+void publish_sink_list(const SinkList* next) {
+    if (const SinkList* previous = record_sinks.exchange(next, std::memory_order_acq_rel)) {
+        retired_sink_lists.push_back(previous);
+        sink_lists_retired.store(true, std::memory_order_relaxed);
+    }
+    reclaim_sink_lists();
 }
 
 void cleanup_message(std::string& message) {
@@ -49,11 +151,68 @@ void cleanup_message(std::string& message) {
     }
 }
 
-void dispatch_to_sinker(std::string_view message) {
+} // namespace
+
+namespace detail {
+
+RcuDomain hook_rcu;
+
+void deliver(std::chrono::system_clock::time_point timestamp, LogLevel level, std::string_view tag,
+             std::string_view payload, const LineOrigin& origin) {
+    ConfigGuard config;
+    DispatchScope scope;
+#if CONFIG_LOGGABLE_ESPIDF_LATENCY_TRACE
+    const uint32_t start = origin.stamps.entry_us != 0 ? latency_now() : 0;
+#endif
+    if (config->route_to_record_sinks) {
+#if CONFIG_LOGGABLE_ESPIDF_TRACE_EVENTS
+        PipelineTraceScope trace_scope("record_sinks");
+#endif
+        consume_record(Record{timestamp, level, tag, payload, task_name(origin.task_id), origin.task_id, origin.core,
+                              RecordKind::Text, BlobFormat::Hex, 0});
+        note_record_sink_bytes(payload.size());
+    }
+#if CONFIG_LOGGABLE_ESPIDF_LATENCY_TRACE
+    const uint32_t sinks_done = start ? latency_now() : 0;
+#endif
+    if (config->route_to_sinker) {
+#if CONFIG_LOGGABLE_ESPIDF_TRACE_EVENTS
+        PipelineTraceScope trace_scope("sinker");
+#endif
+        Sinker::instance().dispatch(LogMessage{timestamp, level, std::string(tag), std::string(payload)});
+        note_sinker_bytes(payload.size());
+    }
+#if CONFIG_LOGGABLE_ESPIDF_LATENCY_TRACE
+    if (start) {
+        record_latency(origin.stamps, start, sinks_done, latency_now());
+    }
+#endif
+}
+
+void deliver_blob(const BlobInfo& info, std::string_view data, const LineOrigin& origin) {
+    const LogLevel level = to_log_level(info.level);
+    const Record record{origin.captured, level, info.tag, data, task_name(origin.task_id), origin.task_id, origin.core,
+                        RecordKind::Blob, info.format, info.address};
+
+    ConfigGuard config;
+    DispatchScope scope;
+    if (config->route_to_record_sinks) {
+        consume_record(record);
+        note_record_sink_bytes(data.size());
+    }
+    if (config->route_to_sinker) {
+        std::string text;
+        render_blob(record, text);
+        note_sinker_bytes(text.size());
+        Sinker::instance().dispatch(LogMessage{record.timestamp, level, std::string(info.tag), std::move(text)});
+    }
+}
+
+void dispatch_line(std::string_view message, const LineOrigin& origin) {
     LogLevel level = LogLevel::Info;
-    std::string tag;  // Empty by default
-    std::string payload;
-    std::chrono::system_clock::time_point timestamp = std::chrono::system_clock::now();
+    std::string_view tag;  // Empty by default
+    std::string_view payload;
+    std::chrono::system_clock::time_point timestamp = origin.captured;
 
     // A typical ESP-IDF log looks like: "L (TIME) TAG: MESSAGE"
     if (message.length() > 4 && message[1] == ' ' && (message[0] == 'E' || message[0] == 'W' || message[0] == 'I' || message[0] == 'D' || message[0] == 'V')) {
@@ -88,48 +247,175 @@ void dispatch_to_sinker(std::string_view message) {
             if (message[time_end + 1] == ' ') {
                 const size_t tag_text_start = time_end + 2;
                 if (tag_text_start < message_start) {
-                    tag = std::string(message.substr(tag_text_start, message_start - tag_text_start));
+                    tag = message.substr(tag_text_start, message_start - tag_text_start);
                 }
             }
 
-            if (message_start < message.length()) {
-                payload = std::string(message.substr(message[message_start + 1] == ' ' ? message_start + 2 : message_start + 1));
-            } else {
-                payload = "";
+            // Lines ending in the colon have an empty payload; the view is not terminated.
+            if (message_start + 1 < message.length()) {
+                payload = message.substr(message[message_start + 1] == ' ' ? message_start + 2 : message_start + 1);
             }
         } else {
-            payload = std::string(message);
+            payload = message;
         }
     } else {
-        payload = std::string(message);
+        payload = message;
     }
     
-    Sinker::instance().dispatch(LogMessage{timestamp, level, std::move(tag), std::move(payload)});
+    deliver(timestamp, level, tag, payload, origin);
 }
 
+void reclaim_retired_sinks() noexcept {
+    if (sink_lists_retired.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(record_sinks_mutex);
+        reclaim_sink_lists();
+    }
+}
+
+bool mirrors_to_console() noexcept {
+    ConfigGuard config;
+    return original_vprintf.load(std::memory_order_acquire) && config->call_original_vprintf;
+}
+
+void console_printf(const char* format, ...) noexcept {
+    const vprintf_like_t original = original_vprintf.load(std::memory_order_acquire);
+    if (!original) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    original(format, args);
+    va_end(args);
+}
+
+} // namespace detail
+
+namespace {
+
+/// Stop the capture pipeline once no hook invocation is in flight.
+bool quiesce_and_shutdown() noexcept {
+    if (!detail::hook_rcu.synchronize(CONFIG_LOGGABLE_ESPIDF_QUIESCE_TIMEOUT_MS)) {
+        shutdown_pending = true;
+        return false;
+    }
+    shutdown_pending = false;
+    detail::capture_stop();
+    Sinker::instance().shutdown();
+    return true;
+}
+
+/**
+ * @brief Clean up a complete record, account it and hand it to the drain
+ *        task or the sinks.
+ *
+ * Every record assembled from vprintf output passes through here, whether
+ * the hook completes it or the sweeper flushes it, so all of them are
+ * accounted, counted and stamped alike. The rate limit has already been
+ * charged when the record was taken out of its task's buffer.
+ *
+ * @param origin Producer of the record; its stamps are those of the log
+ *        call that started it, so time spent held is part of its latency.
+ */
+void commit_line(std::string& message, uint32_t cycles, detail::LineOrigin origin, bool async) {
+    [[maybe_unused]] const uint32_t bytes = message.size();
+    cleanup_message(message);
+#if CONFIG_LOGGABLE_ESPIDF_VOLUME_STATS
+    detail::account_line(origin.task_id, message, bytes, cycles);
+#if CONFIG_LOGGABLE_ESPIDF_SELF_REPORT
+    detail::record_line_cycles(cycles);
+#endif
+#endif
+    (void)cycles;
+    if (!message.empty()) {
+        detail::count_hook_line();
+        if (!async || !detail::capture_line(message, origin)) {
+            detail::stamp_commit(origin.stamps);
+            detail::dispatch_line(message, origin);
+        }
+    }
+}
+
+/**
+ * @brief Commit the record in a task's buffer and empty the buffer.
+ *
+ * Called with the buffer claimed. The record is committed in place, so the
+ * buffer keeps its capacity and the next line of the task does not
+ * allocate.
+ */
+void commit_record(detail::TaskContext& ctx, bool async) {
+    commit_line(ctx.log_buffer, ctx.format_cycles,
+                detail::LineOrigin{ctx.task_id, static_cast<uint8_t>(xPortGetCoreID()),
+                                   std::chrono::system_clock::now(), ctx.stamps},
+                async);
+    ctx.log_buffer.clear();
+    ctx.format_cycles = 0;
+    ctx.partial_since_ms.store(0, std::memory_order_relaxed);
+    ctx.release_held();
+}
+
+/**
+ * @brief The vprintf hook, specialized for a feature set.
+ *
+ * Stages outside `Features` are compiled out; those inside still honour the
+ * active configuration. Lines logged between configure() publishing a
+ * configuration and swapping the variant go through the previous variant.
+ */
+template <uint32_t Features>
 int vprintf_hook(const char* format, va_list args) {
-    if (original_vprintf && _call_original_vprintf) {
+    const detail::LatencyStamps stamps = detail::stamp_entry();
+#if CONFIG_LOGGABLE_ESPIDF_TRACE_EVENTS
+    PipelineTraceScope trace_scope("hook");
+#endif
+    detail::RcuReadGuard in_flight(detail::hook_rcu);
+    const vprintf_like_t original = original_vprintf.load(std::memory_order_acquire);
+    if (!LogHook::is_installed()) [[unlikely]] {
+        // The caller fetched the hook just before uninstall() swapped it out.
+        return original ? original(format, args) : 0;
+    }
+
+    const HookConfig& config = detail::config();
+    if constexpr ((Features & kFilter) != 0) {
+        if (config.max_level != ESP_LOG_VERBOSE || config.tag_levels.count != 0) {
+            const esp_log_level_t level = detail::level_from_format(format);
+            if (level != ESP_LOG_NONE) {
+                if (level > config.max_level) {
+                    return 0;
+                }
+                const char* tag = config.tag_levels.count != 0 ? detail::tag_from_args(format, args) : nullptr;
+                if (tag && level > config.tag_levels.find(tag, ESP_LOG_VERBOSE)) {
+                    return 0;
+                }
+            }
+        }
+    }
+    if (!detail::task_level_allows(format) || !detail::level_cap_allows(format)) {
+        return 0;
+    }
+
+    if ((Features & kMirror) != 0 && original && config.call_original_vprintf) {
         va_list args_copy;
         va_copy(args_copy, args);
-        original_vprintf(format, args_copy);
+        original(format, args_copy);
         va_end(args_copy);
     }
 
-    #if defined(CONFIG_IDF_TARGET_ESP32C3)
-    // ESP32-C3 either has broken TLS or some strange config option that needs tweaking i haven't found, use static instead (safe on single-core)
-    static bool is_logging = false;
-    #else
-    thread_local bool is_logging = false;
-    #endif
-    if (is_logging) {
+    detail::ReentryGuard reentry;
+    if (!reentry) {
+        return 0;
+    }
+
+    detail::TaskContext* ctx = detail::get_task_context();
+    if (!ctx || ctx->capture_suppressed) [[unlikely]] {
         return 0;
     }
-    is_logging = true;
-    struct LoggingGuard {
-        bool& flag;
-        ~LoggingGuard() { flag = false; }
-    } guard{is_logging};
+#if CONFIG_LOGGABLE_ESPIDF_ALLOC_COUNTERS
+    detail::HookAllocScope alloc_scope(*ctx);
+#endif
 
+    [[maybe_unused]] uint32_t format_start = 0;
+    if constexpr (CONFIG_LOGGABLE_ESPIDF_VOLUME_STATS) {
+        format_start = detail::cycle_count();
+    }
     char static_buf[256];
     va_list args_copy;
     va_copy(args_copy, args);
@@ -150,55 +436,201 @@ int vprintf_hook(const char* format, va_list args) {
         va_end(args_copy);
         formatted_message_view = dynamic_message;
     }
+#if CONFIG_LOGGABLE_ESPIDF_TRAFFIC_RECORDER
+    detail::record_traffic(format, formatted_message_view, ctx->task_id);
+#endif
     
-    auto& buffer_state = get_thread_buffer();
+    uint32_t fragment_cycles = 0;
+    if constexpr (CONFIG_LOGGABLE_ESPIDF_VOLUME_STATS) {
+        fragment_cycles = detail::cycle_count() - format_start;
+    }
+    const uint32_t now = esp_log_timestamp();
 
-    buffer_state.log_buffer.append(formatted_message_view);
+    // Framing: text without an ESP-IDF header continues the record held by
+    // this task, a header starts a new one. With a continuation window the
+    // completed record is held until the next header or until the drain
+    // task's sweeper flushes it; otherwise it is committed as soon as it
+    // ends in '\n'. The rate limit is charged once, when a record completes.
+    ctx->acquire_buffer();
+    if (ctx->record_held && detail::starts_with_header(formatted_message_view)) {
+        commit_record(*ctx, config.async_capture);
+    }
+    if (ctx->log_buffer.empty() || ctx->record_held) {
+        ctx->partial_since_ms.store(now ? now : 1, std::memory_order_relaxed);
+    }
+    if (ctx->log_buffer.empty()) {
+        ctx->partial_core = static_cast<uint8_t>(xPortGetCoreID());
+        ctx->stamps = stamps;
+    }
+    ctx->log_buffer.append(formatted_message_view);
+    ctx->format_cycles += fragment_cycles;
 
-    if (!buffer_state.log_buffer.empty() && buffer_state.log_buffer.back() == '\n') {
-        std::string complete_message = std::move(buffer_state.log_buffer);
-        
-        buffer_state.log_buffer.clear();
-        
-        cleanup_message(complete_message);
-        if (!complete_message.empty()) {
-            dispatch_to_sinker(complete_message);
+    if (!ctx->record_held && ctx->log_buffer.back() == '\n') {
+        bool allowed = true;
+        if constexpr ((Features & kRateLimit) != 0) {
+            allowed = detail::rate_allows(*ctx, config.task_lines_per_second, now);
+        }
+        if (!allowed) {
+            ctx->log_buffer.clear();
+            ctx->format_cycles = 0;
+            ctx->partial_since_ms.store(0, std::memory_order_relaxed);
+        } else if (config.continuation_window_ms != 0 && config.async_capture && detail::capture_running()) {
+            ctx->hold();
+        } else {
+            commit_record(*ctx, config.async_capture);
         }
     }
+    ctx->release_buffer();
     return size;
 }
 
+template <size_t... Masks>
+constexpr std::array<vprintf_like_t, sizeof...(Masks)> make_hook_variants(std::index_sequence<Masks...>) {
+    return {&vprintf_hook<Masks & kCompiledFeatures>...};
+}
+
+/// Every variant select_hook() can return, indexed by feature mask; masks
+/// differing only in features that are compiled out share an instantiation.
+constexpr auto hook_variants = make_hook_variants(std::make_index_sequence<1u << kHookFeatureCount>{});
+
+/// Pick the leanest variant that covers a configuration.
+vprintf_like_t select_hook(const HookConfig& config) {
+    uint32_t features = 0;
+    if (config.call_original_vprintf) {
+        features |= kMirror;
+    }
+    if (config.max_level != ESP_LOG_VERBOSE || config.tag_levels.count != 0) {
+        features |= kFilter;
+    }
+    if (config.task_lines_per_second != 0) {
+        features |= kRateLimit;
+    }
+    return hook_variants[features & kCompiledFeatures];
+}
+
+bool is_hook_variant(vprintf_like_t fn) {
+    return std::find(hook_variants.begin(), hook_variants.end(), fn) != hook_variants.end();
 }
 
+/// Point ESP-IDF at the variant for the active configuration. Called with hook_swap_mutex held.
+void swap_in_hook() {
+    vprintf_like_t next;
+    {
+        detail::ConfigGuard config;
+        next = select_hook(*config);
+    }
+    if (next != active_hook) {
+        const vprintf_like_t previous = esp_log_set_vprintf(next);
+        if (!is_hook_variant(previous)) {
+            original_vprintf.store(previous, std::memory_order_release);
+        }
+        active_hook = next;
+    }
+}
+
+}
+
+namespace detail {
+
+void flush_line(std::string& line, const LineOrigin& origin, uint32_t cycles) {
+    // Lines flushed by the drain task's sweeper are delivered right here;
+    // queueing them would be dropped as output of a sink.
+    commit_line(line, cycles, origin, !on_drain_task());
+}
+
+void reselect_hook() noexcept {
+    std::lock_guard<std::mutex> lock(hook_swap_mutex);
+    if (LogHook::is_installed()) {
+        swap_in_hook();
+    }
+}
+
+} // namespace detail
+
 std::atomic<bool> LogHook::_installed{false};
 
-void LogHook::install(bool call_original_vprintf) noexcept {
+void LogHook::install(std::optional<bool> call_original_vprintf) noexcept {
     std::lock_guard<std::mutex> lock(hook_mutex);
-    _call_original_vprintf = call_original_vprintf;
+#if CONFIG_LOGGABLE_ESPIDF_PERSIST_CONFIG
+    if (!_installed.load(std::memory_order_acquire) && !shutdown_pending) {
+        load_config();
+    }
+#endif
+    if (call_original_vprintf) {
+        HookConfig config = LogHook::config();
+        if (config.call_original_vprintf != *call_original_vprintf) {
+            config.call_original_vprintf = *call_original_vprintf;
+            configure(config);
+        }
+    }
     if (!_installed.load(std::memory_order_acquire)) {
-        os::set_backend(&os::get_freertos_backend());
+        if (!shutdown_pending) {
+            os::set_backend(&os::get_freertos_backend());
 
-        Sinker::instance().init();
+            Sinker::instance().init();
+            detail::capture_start();
+#if CONFIG_LOGGABLE_ESPIDF_MEMORY_GOVERNOR
+            detail::governor_start();
+#endif
+        }
+        shutdown_pending = false;
 
-        original_vprintf = esp_log_set_vprintf(&vprintf_hook);
+        std::lock_guard<std::mutex> swap_lock(hook_swap_mutex);
         _installed.store(true, std::memory_order_release);
+        swap_in_hook();
     }
 }
 
-void LogHook::uninstall() noexcept {
+bool LogHook::uninstall() noexcept {
     std::lock_guard<std::mutex> lock(hook_mutex);
     if (_installed.load(std::memory_order_acquire)) {
-        esp_log_set_vprintf(original_vprintf);
-        original_vprintf = nullptr;
-        _installed.store(false, std::memory_order_release);
-
-        Sinker::instance().shutdown();
+        {
+            std::lock_guard<std::mutex> swap_lock(hook_swap_mutex);
+            esp_log_set_vprintf(original_vprintf.load(std::memory_order_acquire));
+            active_hook = nullptr;
+            _installed.store(false, std::memory_order_release);
+        }
+        return quiesce_and_shutdown();
     }
+    return !shutdown_pending || quiesce_and_shutdown();
 }
 
 bool LogHook::is_installed() noexcept {
     return _installed.load(std::memory_order_acquire);
 }
 
+void LogHook::add_record_sink(std::shared_ptr<IRecordSink> sink) noexcept {
+    if (!sink) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(record_sinks_mutex);
+    auto* next = new (std::nothrow) SinkList();
+    if (!next) {
+        return;
+    }
+    if (const SinkList* current = record_sinks.load(std::memory_order_relaxed)) {
+        next->sinks = current->sinks;
+    }
+    next->sinks.push_back(std::move(sink));
+    publish_sink_list(next);
+}
+
+void LogHook::remove_record_sink(const std::shared_ptr<IRecordSink>& sink) noexcept {
+    std::lock_guard<std::mutex> lock(record_sinks_mutex);
+    const SinkList* current = record_sinks.load(std::memory_order_relaxed);
+    if (!current || std::find(current->sinks.begin(), current->sinks.end(), sink) == current->sinks.end()) {
+        return;
+    }
+    SinkList* next = nullptr;
+    if (current->sinks.size() > 1) {
+        next = new (std::nothrow) SinkList();
+        if (!next) {
+            return;
+        }
+        std::remove_copy(current->sinks.begin(), current->sinks.end(), std::back_inserter(next->sinks), sink);
+    }
+    publish_sink_list(next);
+}
+
 } // namespace espidf
 } // namespace loggable
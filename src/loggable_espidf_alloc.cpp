@@ -0,0 +1,92 @@
+#include "loggable_espidf_alloc.hpp"
+#include "loggable_espidf_capture.hpp"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <cstddef>
+
+namespace loggable {
+namespace espidf {
+
+#if CONFIG_LOGGABLE_ESPIDF_ALLOC_COUNTERS
+
+namespace detail {
+
+std::atomic<uint32_t> hook_lines{0};
+std::atomic<uint32_t> deliveries{0};
+
+namespace {
+
+static std::atomic<uint32_t> hook_allocations{0};
+static std::atomic<uint32_t> delivery_allocations{0};
+
+} // namespace
+
+} // namespace detail
+
+AllocationReport LogHook::allocation_report(bool reset) noexcept {
+    // Four independent counters: a reset racing with logging may split a
+    // line from its allocations, which is noise in a steady-state window.
+    AllocationReport report{};
+    if (reset) {
+        report.hook_lines = detail::hook_lines.exchange(0, std::memory_order_relaxed);
+        report.hook_allocations = detail::hook_allocations.exchange(0, std::memory_order_relaxed);
+        report.deliveries = detail::deliveries.exchange(0, std::memory_order_relaxed);
+        report.delivery_allocations = detail::delivery_allocations.exchange(0, std::memory_order_relaxed);
+    } else {
+        report.hook_lines = detail::hook_lines.load(std::memory_order_relaxed);
+        report.hook_allocations = detail::hook_allocations.load(std::memory_order_relaxed);
+        report.deliveries = detail::deliveries.load(std::memory_order_relaxed);
+        report.delivery_allocations = detail::delivery_allocations.load(std::memory_order_relaxed);
+    }
+    return report;
+}
+
+bool LogHook::within_allocation_budget(const AllocationBudget& budget, AllocationReport* out) noexcept {
+    const AllocationReport report = allocation_report();
+    if (out) {
+        *out = report;
+    }
+    return report.hook_allocations <= static_cast<uint64_t>(report.hook_lines) * budget.per_hook_line &&
+           report.delivery_allocations <= static_cast<uint64_t>(report.deliveries) * budget.per_delivery;
+}
+
+} // namespace espidf
+} // namespace loggable
+
+/**
+ * @brief ESP-IDF heap hook, called after every successful allocation when
+ *        CONFIG_HEAP_USE_HOOKS is set.
+ *
+ * Charges the allocation to the logging path the calling task is on. Runs
+ * inside malloc, so it only reads the task's context and bumps a counter.
+ */
+extern "C" void esp_heap_trace_alloc_hook(void* ptr, size_t, uint32_t) {
+    using namespace loggable::espidf::detail;
+    if (!ptr || xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED || xPortInIsrContext()) {
+        return;
+    }
+    const TaskContext* ctx = find_task_context();
+    if ((ctx && ctx->sink_dispatch_depth != 0) || on_drain_task()) {
+        delivery_allocations.fetch_add(1, std::memory_order_relaxed);
+    } else if (ctx && ctx->in_hook) {
+        hook_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+#else
+
+AllocationReport LogHook::allocation_report(bool) noexcept {
+    return AllocationReport{};
+}
+
+bool LogHook::within_allocation_budget(const AllocationBudget&, AllocationReport* out) noexcept {
+    if (out) {
+        *out = AllocationReport{};
+    }
+    return false;
+}
+
+} // namespace espidf
+} // namespace loggable
+
+#endif // CONFIG_LOGGABLE_ESPIDF_ALLOC_COUNTERS
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "loggable_espidf.hpp"
+#include "loggable_espidf_task.hpp"
+#include <atomic>
+#include <cstdint>
+
+#ifndef CONFIG_LOGGABLE_ESPIDF_ALLOC_COUNTERS
+#define CONFIG_LOGGABLE_ESPIDF_ALLOC_COUNTERS 0
+#endif
+
+namespace loggable {
+namespace espidf {
+namespace detail {
+
+#if CONFIG_LOGGABLE_ESPIDF_ALLOC_COUNTERS
+/// Denominators of the allocation report. Defined in loggable_espidf_alloc.cpp.
+extern std::atomic<uint32_t> hook_lines;
+extern std::atomic<uint32_t> deliveries;
+
+/**
+ * @brief Marks the calling task as running the hook, so its heap
+ *        allocations are charged to the hook path.
+ */
+class HookAllocScope {
+public:
+    explicit HookAllocScope(TaskContext& ctx) noexcept : _ctx(ctx) { _ctx.in_hook = true; }
+    ~HookAllocScope() { _ctx.in_hook = false; }
+
+    HookAllocScope(const HookAllocScope&) = delete;
+    HookAllocScope& operator=(const HookAllocScope&) = delete;
+
+private:
+    TaskContext& _ctx;
+};
+#endif
+
+inline void count_hook_line() noexcept {
+#if CONFIG_LOGGABLE_ESPIDF_ALLOC_COUNTERS
+    hook_lines.fetch_add(1, std::memory_order_relaxed);
+#endif
+}
+
+inline void count_delivery() noexcept {
+#if CONFIG_LOGGABLE_ESPIDF_ALLOC_COUNTERS
+    deliveries.fetch_add(1, std::memory_order_relaxed);
+#endif
+}
+
+} // namespace detail
+} // namespace espidf
+} // namespace loggable
@@ -0,0 +1,174 @@
+#include "loggable_espidf.hpp"
+#include "loggable_espidf_capture.hpp"
+#include "loggable_espidf_config.hpp"
+#include "loggable_espidf_stats.hpp"
+#include "loggable_espidf_task.hpp"
+#include <esp_log.h>
+#include <cctype>
+#include <cinttypes>
+#include <cstdio>
+
+namespace loggable {
+namespace espidf {
+
+namespace {
+
+constexpr size_t kBytesPerLine = 16;
+
+void render_hex_line(const uint8_t* data, size_t length, std::string& out) {
+    char item[4];
+    for (size_t i = 0; i < length; ++i) {
+        std::snprintf(item, sizeof(item), i == 0 ? "%02x" : " %02x", data[i]);
+        out += item;
+    }
+}
+
+void render_hexdump_line(uint32_t address, const uint8_t* data, size_t length, std::string& out) {
+    char item[16];
+    std::snprintf(item, sizeof(item), "0x%08" PRIx32 "  ", address);
+    out += item;
+    for (size_t i = 0; i < kBytesPerLine; ++i) {
+        if (i == kBytesPerLine / 2) {
+            out += ' ';
+        }
+        if (i < length) {
+            std::snprintf(item, sizeof(item), " %02x", data[i]);
+            out += item;
+        } else {
+            out += "   ";
+        }
+    }
+    out += "  |";
+    for (size_t i = 0; i < length; ++i) {
+        out += std::isprint(data[i]) ? static_cast<char>(data[i]) : '.';
+    }
+    out += '|';
+}
+
+} // namespace
+
+void render_blob(const Record& record, std::string& out) {
+    if (record.kind != RecordKind::Blob) {
+        out.append(record.payload);
+        return;
+    }
+
+    const auto* data = reinterpret_cast<const uint8_t*>(record.payload.data());
+    const size_t length = record.payload.size();
+    for (size_t offset = 0; offset < length; offset += kBytesPerLine) {
+        const size_t line_length = length - offset < kBytesPerLine ? length - offset : kBytesPerLine;
+        if (offset != 0) {
+            out += '\n';
+        }
+        switch (record.blob_format) {
+            case BlobFormat::Hex:
+                render_hex_line(data + offset, line_length, out);
+                break;
+            case BlobFormat::Char:
+                out.append(reinterpret_cast<const char*>(data + offset), line_length);
+                break;
+            case BlobFormat::HexDump:
+                render_hexdump_line(record.blob_address + offset, data + offset, line_length, out);
+                break;
+        }
+    }
+}
+
+void LogHook::log_buffer(const char* tag, const void* data, size_t length, esp_log_level_t level,
+                         BlobFormat format) noexcept {
+    detail::RcuReadGuard in_flight(detail::hook_rcu);
+    const HookConfig& config = detail::config();
+    if (!is_installed() || length == 0 || !detail::task_level_allows_level(level) ||
+        !detail::level_cap_allows(level)) {
+        return;
+    }
+#if CONFIG_LOGGABLE_ESPIDF_HOOK_FILTERS
+    if (level > config.max_level ||
+        (config.tag_levels.count != 0 && tag && level > config.tag_levels.find(tag, ESP_LOG_VERBOSE))) {
+        return;
+    }
+#endif
+    detail::ReentryGuard reentry;
+    if (!reentry) {
+        return;
+    }
+    detail::TaskContext* ctx = detail::get_task_context();
+    if (!ctx || ctx->capture_suppressed) {
+        return;
+    }
+
+    const detail::BlobInfo info{level, format, static_cast<uint32_t>(reinterpret_cast<uintptr_t>(data)),
+                                tag ? std::string_view(tag) : std::string_view()};
+    const std::string_view bytes(static_cast<const char*>(data), length);
+    const detail::LineOrigin origin{ctx->task_id, static_cast<uint8_t>(xPortGetCoreID()),
+                                    std::chrono::system_clock::now()};
+#if CONFIG_LOGGABLE_ESPIDF_VOLUME_STATS
+    detail::account_record(ctx->task_id, info.tag, length, 0);
+#endif
+    if (!config.async_capture || !detail::capture_blob(info, bytes, origin)) {
+        detail::deliver_blob(info, bytes, origin);
+    }
+}
+
+} // namespace espidf
+} // namespace loggable
+
+#if CONFIG_LOGGABLE_ESPIDF_CAPTURE_BUFFER_DUMPS
+
+// Linked with -Wl,--wrap so the ESP_LOG_BUFFER_* macros capture one blob
+// instead of one formatted line per 16 bytes. The console still gets the
+// usual rendering from the real implementation, with capture suppressed.
+
+namespace {
+
+using buffer_dump_fn = void (*)(const char*, const void*, uint16_t, esp_log_level_t);
+
+void capture_buffer_dump(buffer_dump_fn real, loggable::espidf::BlobFormat format, const char* tag,
+                         const void* buffer, uint16_t buff_len, esp_log_level_t level) {
+    using namespace loggable::espidf;
+    if (!LogHook::is_installed()) {
+        real(tag, buffer, buff_len, level);
+        return;
+    }
+    if (level > esp_log_level_get(tag)) {
+        return;
+    }
+
+    if (detail::mirrors_to_console()) {
+        if (detail::TaskContext* ctx = detail::get_task_context()) {
+            ctx->capture_suppressed = true;
+            real(tag, buffer, buff_len, level);
+            ctx->capture_suppressed = false;
+        }
+    }
+    LogHook::log_buffer(tag, buffer, buff_len, level, format);
+}
+
+} // namespace
+
+extern "C" {
+
+void __real_esp_log_buffer_hex_internal(const char* tag, const void* buffer, uint16_t buff_len, esp_log_level_t level);
+void __real_esp_log_buffer_char_internal(const char* tag, const void* buffer, uint16_t buff_len, esp_log_level_t level);
+void __real_esp_log_buffer_hexdump_internal(const char* tag, const void* buffer, uint16_t buff_len,
+                                            esp_log_level_t level);
+
+void __wrap_esp_log_buffer_hex_internal(const char* tag, const void* buffer, uint16_t buff_len, esp_log_level_t level) {
+    capture_buffer_dump(&__real_esp_log_buffer_hex_internal, loggable::espidf::BlobFormat::Hex, tag, buffer, buff_len,
+                        level);
+}
+
+void __wrap_esp_log_buffer_char_internal(const char* tag, const void* buffer, uint16_t buff_len, esp_log_level_t level) {
+    capture_buffer_dump(&__real_esp_log_buffer_char_internal, loggable::espidf::BlobFormat::Char, tag, buffer,
+                        buff_len, level);
+}
+
+void __wrap_esp_log_buffer_hexdump_internal(const char* tag, const void* buffer, uint16_t buff_len,
+                                            esp_log_level_t level) {
+    capture_buffer_dump(&__real_esp_log_buffer_hexdump_internal, loggable::espidf::BlobFormat::HexDump, tag, buffer,
+                        buff_len, level);
+}
+
+} // extern "C"
+
+#endif // CONFIG_LOGGABLE_ESPIDF_CAPTURE_BUFFER_DUMPS
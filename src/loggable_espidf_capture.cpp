@@ -0,0 +1,699 @@
+#include "loggable_espidf_capture.hpp"
+#include "loggable_espidf_config.hpp"
+#include "loggable_espidf_governor.hpp"
+#include "loggable_espidf_report.hpp"
+#include "loggable_espidf_task.hpp"
+#include "loggable_espidf_trace.hpp"
+#include "loggable_os.hpp"
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <cstddef>
+#include <cstring>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+
+namespace loggable {
+
+namespace os {
+IAsyncBackend& get_freertos_backend() noexcept;
+} // namespace os
+
+namespace espidf {
+namespace detail {
+
+namespace {
+
+enum CapturedKind : uint8_t {
+    kCapturedLine,
+    kCapturedBlob,
+    kCapturedFormat,
+    kCapturedSkipped,  ///< Popped but not copied out; never stored in the buffer.
+};
+
+/// Or'ed into CapturedHeader::kind for entries queued without a credit slot.
+constexpr uint8_t kUncredited = 0x80;
+
+/// Header written in front of every entry in the capture buffer.
+struct CapturedHeader {
+    uint32_t length;
+    uint16_t task_id;
+    uint8_t core;
+    uint8_t kind;
+    int64_t captured_us;
+    [[no_unique_address]] LatencyStamps stamps;
+};
+
+/// Follows CapturedHeader for blobs, before the tag and the raw bytes.
+struct CapturedBlob {
+    uint32_t address;
+    uint8_t level;
+    uint8_t format;
+    uint8_t tag_length;
+    uint8_t reserved;
+};
+
+/// Follows CapturedHeader for formatted records, before the tag and the arguments.
+struct CapturedFormat {
+    const char* format;
+    uint8_t level;
+    uint8_t tag_length;
+    uint16_t reserved;
+};
+
+/// Credit state of one producer, see find_credit().
+struct ProducerCredit {
+    uint16_t task_id;
+    uint32_t in_flight;
+    uint32_t dropped_lines;
+    uint32_t dropped_bytes;
+};
+
+constexpr size_t kProducerSlots = CONFIG_LOGGABLE_ESPIDF_TASK_NAMES;
+
+// Producers on both cores write the ring state under ring_mutex and read
+// `running` and the drain task handle on every line without it. Keeping the
+// two groups on separate cache lines stops the lock holder's writes from
+// invalidating everyone's read-mostly line.
+alignas(64) static std::mutex ring_mutex;
+static uint32_t ring_acquisitions = 0;
+static uint32_t ring_contentions = 0;
+static uint8_t* ring = nullptr;
+static size_t ring_capacity = 0;
+static size_t ring_head = 0;
+static size_t ring_tail = 0;
+static size_t ring_used = 0;
+static size_t fair_share = 0;
+static size_t reserved = 0;
+static size_t high_water = 0;
+static ProducerCredit credits[kProducerSlots];
+static uint32_t dropped_lines = 0;
+static uint32_t dropped_bytes = 0;
+static std::atomic<uint32_t> dropped_total{0};
+
+alignas(64) static std::atomic<bool> running{false};
+static os::SemaphoreHandle wake_sem;
+static os::SemaphoreHandle done_sem;
+static std::atomic<TaskHandle_t> drain_task{nullptr};
+// Static: the task ends in task_delete(), which skips destructors, and the
+// heap buffer of long entries is worth keeping across restarts.
+static CapturedMessage drain_message;
+
+/// Take ring_mutex, counting acquisitions that had to wait for another holder when LOCK_COUNTERS is on.
+std::unique_lock<std::mutex> lock_ring() {
+    if constexpr (!CONFIG_LOGGABLE_ESPIDF_LOCK_COUNTERS) {
+        return std::unique_lock<std::mutex>(ring_mutex);
+    } else {
+        std::unique_lock<std::mutex> lock(ring_mutex, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            lock.lock();
+            ++ring_contentions;
+        }
+        ++ring_acquisitions;
+        return lock;
+    }
+}
+
+/// A slot belongs to one task id while it has bytes in flight or unreported drops.
+bool owned(const ProducerCredit& credit) {
+    return credit.in_flight != 0 || credit.dropped_lines != 0;
+}
+
+/**
+ * @brief Find the credit slot of a producer. Called with ring_mutex held.
+ *
+ * Slots are probed linearly from `task_id % kProducerSlots`, so tasks whose
+ * ids collide still get a share each. release_credit() keeps every probe run
+ * free of gaps, so the first free slot ends the search: a producer with
+ * nothing in flight usually finds its home slot free and claims it.
+ *
+ * @param claim Take the first free slot if the producer has none.
+ * @return The slot, or nullptr if the producer has none and, when claiming,
+ *         every slot belongs to another producer.
+ */
+ProducerCredit* find_credit(uint16_t task_id, bool claim) {
+    for (size_t i = 0, slot = task_id % kProducerSlots; i < kProducerSlots; ++i, slot = (slot + 1) % kProducerSlots) {
+        ProducerCredit& credit = credits[slot];
+        if (!owned(credit)) {
+            if (!claim) {
+                return nullptr;
+            }
+            credit.task_id = task_id;
+            return &credit;
+        }
+        if (credit.task_id == task_id) {
+            return &credit;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Close the gap a slot leaves in its probe run when it stops being owned.
+ *
+ * Backward-shift deletion: later slots of the run whose home is not between
+ * the gap and themselves move into it, so find_credit() never stops short of
+ * a slot that is still owned. Called with ring_mutex held.
+ */
+void release_credit(size_t gap) {
+    for (size_t next = (gap + 1) % kProducerSlots; owned(credits[next]); next = (next + 1) % kProducerSlots) {
+        const size_t home = credits[next].task_id % kProducerSlots;
+        const bool reachable = gap < next ? gap < home && home <= next : gap < home || home <= next;
+        if (!reachable) {
+            credits[gap] = credits[next];
+            credits[next] = ProducerCredit{};
+            gap = next;
+        }
+    }
+}
+
+/// Re-insert every owned slot after several were released at once. Called with ring_mutex held.
+void rehash_credits() {
+    ProducerCredit previous[kProducerSlots];
+    std::memcpy(previous, credits, sizeof(credits));
+    std::memset(credits, 0, sizeof(credits));
+    for (const ProducerCredit& credit : previous) {
+        if (owned(credit)) {
+            *find_credit(credit.task_id, true) = credit;
+        }
+    }
+}
+
+/// Part of a producer's guaranteed share it is not using but is entitled to.
+size_t unused_share(uint32_t in_flight) {
+    return in_flight > 0 && in_flight < fair_share ? fair_share - in_flight : 0;
+}
+
+/// Change a producer's in-flight bytes, keeping `reserved` in sync.
+void set_in_flight(ProducerCredit& credit, uint32_t in_flight) {
+    reserved -= unused_share(credit.in_flight);
+    credit.in_flight = in_flight;
+    reserved += unused_share(credit.in_flight);
+    if (!owned(credit)) {
+        release_credit(&credit - credits);
+    }
+}
+
+void ring_write(const void* data, size_t size) {
+    const size_t first = std::min(size, ring_capacity - ring_head);
+    std::memcpy(ring + ring_head, data, first);
+    std::memcpy(ring, static_cast<const uint8_t*>(data) + first, size - first);
+    ring_head = (ring_head + size) % ring_capacity;
+}
+
+void ring_read(void* data, size_t size) {
+    const size_t first = std::min(size, ring_capacity - ring_tail);
+    std::memcpy(data, ring + ring_tail, first);
+    std::memcpy(static_cast<uint8_t*>(data) + first, ring, size - first);
+    ring_tail = (ring_tail + size) % ring_capacity;
+}
+
+void deliver_captured_blob(std::string_view body, const LineOrigin& origin) {
+    CapturedBlob blob;
+    std::memcpy(&blob, body.data(), sizeof(blob));
+    body.remove_prefix(sizeof(blob));
+    const BlobInfo info{static_cast<esp_log_level_t>(blob.level), static_cast<BlobFormat>(blob.format), blob.address,
+                        body.substr(0, blob.tag_length)};
+    deliver_blob(info, body.substr(blob.tag_length), origin);
+}
+
+void deliver_captured_format(std::string_view body, const LineOrigin& origin) {
+    CapturedFormat entry;
+    std::memcpy(&entry, body.data(), sizeof(entry));
+    body.remove_prefix(sizeof(entry));
+    const FormattedInfo info{static_cast<esp_log_level_t>(entry.level), entry.format, body.substr(0, entry.tag_length)};
+    deliver_formatted(info, body.substr(entry.tag_length), origin);
+}
+
+/// Release a popped entry's space and credit and fill in its origin. Called with ring_mutex held.
+void retire_entry(const CapturedHeader& header, LineOrigin& origin) {
+    const uint32_t size = sizeof(header) + header.length;
+    ring_used -= size;
+    if ((header.kind & kUncredited) == 0) {
+        if (ProducerCredit* credit = find_credit(header.task_id, false)) {
+            set_in_flight(*credit, credit->in_flight - size);
+        }
+    }
+
+    origin.task_id = header.task_id;
+    origin.core = header.core;
+    origin.captured = std::chrono::system_clock::time_point(std::chrono::microseconds(header.captured_us));
+    origin.stamps = header.stamps;
+}
+
+/// Pop one entry into `body`. Called by the drain task only.
+bool pop_entry(CapturedMessage& body, uint8_t& kind, LineOrigin& origin) {
+    const auto lock = lock_ring();
+    if (ring_used == 0) {
+        return false;
+    }
+    CapturedHeader header;
+    ring_read(&header, sizeof(header));
+    if (char* storage = body.prepare(header.length)) {
+        ring_read(storage, header.length);
+        kind = header.kind & ~kUncredited;
+    } else {
+        // Out of memory for a long entry: skip it rather than stall the drain.
+        ring_tail = (ring_tail + header.length) % ring_capacity;
+        kind = kCapturedSkipped;
+    }
+    retire_entry(header, origin);
+    return true;
+}
+
+#if CONFIG_LOGGABLE_ESPIDF_DRAIN_BATCH_BYTES
+/// An entry popped into the batch arena.
+struct BatchEntry {
+    uint8_t kind;
+    LineOrigin origin;
+    std::string_view body;
+};
+
+constexpr size_t kBatchEntries = 32;
+
+alignas(std::max_align_t) static std::byte batch_storage[CONFIG_LOGGABLE_ESPIDF_DRAIN_BATCH_BYTES];
+static BatchEntry batch[kBatchEntries];
+
+/**
+ * @brief Pop as many entries as fit into the batch arena, under one lock.
+ *
+ * Bodies are bump-allocated from `arena`, which the caller releases in one
+ * step once every sink has seen the batch. Called by the drain task only.
+ *
+ * @return Number of entries popped; 0 if the buffer is empty or its next
+ *         entry alone exceeds the arena, which pop_entry() then handles.
+ */
+size_t pop_batch(std::pmr::monotonic_buffer_resource& arena) {
+    const auto lock = lock_ring();
+    size_t count = 0;
+    size_t budget = sizeof(batch_storage);
+    while (ring_used != 0 && count < kBatchEntries) {
+        const size_t tail = ring_tail;
+        CapturedHeader header;
+        ring_read(&header, sizeof(header));
+        const size_t length = header.length ? header.length : 1;
+        if (length > budget) {
+            ring_tail = tail;
+            break;
+        }
+        budget -= length;
+        char* storage = static_cast<char*>(arena.allocate(length, 1));
+        ring_read(storage, header.length);
+
+        BatchEntry& entry = batch[count++];
+        entry.kind = header.kind & ~kUncredited;
+        entry.body = std::string_view(storage, header.length);
+        retire_entry(header, entry.origin);
+    }
+    note_batch_usage(sizeof(batch_storage) - budget);
+    return count;
+}
+#endif
+
+/// Hand one popped entry to the sinks.
+void deliver_entry(uint8_t kind, std::string_view body, const LineOrigin& origin) {
+    if (kind == kCapturedBlob) {
+        deliver_captured_blob(body, origin);
+    } else if (kind == kCapturedFormat) {
+        deliver_captured_format(body, origin);
+    } else if (kind == kCapturedLine) {
+        dispatch_line(body, origin);
+    }
+}
+
+/// Deliver everything queued so far. Called by the drain task only.
+void drain_entries() {
+    CapturedMessage& body = drain_message;
+    uint8_t kind;
+    LineOrigin origin{};
+#if CONFIG_LOGGABLE_ESPIDF_DRAIN_BATCH_BYTES
+    // Allocations past the storage, which the budget in pop_batch() rules
+    // out, would fail rather than fall back to the heap.
+    std::pmr::monotonic_buffer_resource arena(batch_storage, sizeof(batch_storage),
+                                              std::pmr::null_memory_resource());
+    for (;;) {
+        const size_t count = pop_batch(arena);
+        if (count == 0) {
+            if (!pop_entry(body, kind, origin)) {
+                return;
+            }
+            deliver_entry(kind, body.view(), origin);
+            continue;
+        }
+        {
+#if CONFIG_LOGGABLE_ESPIDF_TRACE_EVENTS
+            PipelineTraceScope trace_scope("batch");
+#endif
+            for (size_t i = 0; i < count; ++i) {
+                deliver_entry(batch[i].kind, batch[i].body, batch[i].origin);
+            }
+        }
+        arena.release();
+    }
+#else
+    while (pop_entry(body, kind, origin)) {
+        deliver_entry(kind, body.view(), origin);
+    }
+#endif
+}
+
+/**
+ * @brief Queue an entry made of `parts`, applying the producer's fair share.
+ * @return false if capture is not running.
+ */
+bool enqueue(uint8_t kind, const LineOrigin& origin, const std::string_view* parts, size_t part_count) {
+    if (!running.load(std::memory_order_acquire)) {
+        return false;
+    }
+    // Lines logged by sinks on the drain task would feed back into the
+    // buffer; drop them like the hook's recursion guard does.
+    if (on_drain_task()) {
+        return true;
+    }
+
+    CapturedHeader header{0, origin.task_id, origin.core, kind,
+                          std::chrono::duration_cast<std::chrono::microseconds>(origin.captured.time_since_epoch()).count(),
+                          origin.stamps};
+    for (size_t i = 0; i < part_count; ++i) {
+        header.length += parts[i].size();
+    }
+    const uint32_t size = sizeof(header) + header.length;
+    {
+        const auto lock = lock_ring();
+        if (!ring) {
+            return false;
+        }
+        // A producer that finds every slot taken has no guaranteed share and
+        // may only borrow.
+        ProducerCredit* credit = find_credit(origin.task_id, true);
+        const uint32_t in_flight = credit ? credit->in_flight : 0;
+
+        // Within its share a producer only needs the space; when borrowing it
+        // must leave the unused shares of the others plus one share for a
+        // producer that has nothing queued yet.
+        const bool within_share = credit && in_flight + size <= fair_share;
+        const size_t keep_free = within_share ? 0 : reserved - unused_share(in_flight) + fair_share;
+        if (ring_used + size + keep_free > ring_capacity) {
+            if (credit) {
+                credit->dropped_lines += 1;
+                credit->dropped_bytes += header.length;
+            }
+            dropped_lines += 1;
+            dropped_bytes += header.length;
+            dropped_total.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        if (!credit) {
+            header.kind |= kUncredited;
+        }
+        stamp_commit(header.stamps);
+        ring_write(&header, sizeof(header));
+        for (size_t i = 0; i < part_count; ++i) {
+            ring_write(parts[i].data(), parts[i].size());
+        }
+        ring_used += size;
+        high_water = ring_used > high_water ? ring_used : high_water;
+        if (credit) {
+            set_in_flight(*credit, in_flight + size);
+        }
+        os::get_freertos_backend().semaphore_give(wake_sem);
+    }
+    return true;
+}
+
+/// Report lines dropped since the last summary, naming the worst offenders.
+void report_drops() {
+    if (const uint32_t limited = take_rate_limited()) {
+        char text[64];
+        std::snprintf(text, sizeof(text), "rate limit dropped %" PRIu32 " lines", limited);
+        const LineOrigin origin{0, static_cast<uint8_t>(xPortGetCoreID()), std::chrono::system_clock::now()};
+        deliver(origin.captured, LogLevel::Warning, "loggable", text, origin);
+    }
+
+    constexpr size_t kOffenders = 3;
+    ProducerCredit worst[kOffenders] = {};
+    uint32_t lines;
+    uint32_t bytes;
+    {
+        const auto lock = lock_ring();
+        if (dropped_lines == 0) {
+            return;
+        }
+        lines = dropped_lines;
+        bytes = dropped_bytes;
+        dropped_lines = 0;
+        dropped_bytes = 0;
+        for (ProducerCredit& credit : credits) {
+            if (credit.dropped_lines == 0) {
+                continue;
+            }
+            for (size_t i = 0; i < kOffenders; ++i) {
+                if (credit.dropped_lines > worst[i].dropped_lines) {
+                    std::memmove(&worst[i + 1], &worst[i], (kOffenders - i - 1) * sizeof(ProducerCredit));
+                    worst[i] = credit;
+                    break;
+                }
+            }
+            credit.dropped_lines = 0;
+            credit.dropped_bytes = 0;
+        }
+        rehash_credits();
+    }
+
+    char text[160];
+    int length = std::snprintf(text, sizeof(text), "capture buffer full, dropped %" PRIu32 " lines (%" PRIu32 " bytes):",
+                               lines, bytes);
+    for (size_t i = 0; i < kOffenders && worst[i].dropped_lines != 0 && length < static_cast<int>(sizeof(text)); ++i) {
+        length += std::snprintf(text + length, sizeof(text) - length, " %s=%" PRIu32, task_name(worst[i].task_id),
+                                worst[i].dropped_lines);
+    }
+
+    const LineOrigin origin{0, static_cast<uint8_t>(xPortGetCoreID()), std::chrono::system_clock::now()};
+    deliver(origin.captured, LogLevel::Warning, "loggable", text, origin);
+}
+
+void drain_main(void*) {
+    auto& backend = os::get_freertos_backend();
+    drain_task.store(xTaskGetCurrentTaskHandle(), std::memory_order_release);
+
+    uint32_t last_sweep = esp_log_timestamp();
+    bool stopping = false;
+    while (!stopping) {
+        // Held records are due within the continuation window, so sweep at
+        // that pace only while some exist.
+        uint32_t interval;
+        {
+            ConfigGuard config;
+            interval = held_records.load(std::memory_order_relaxed) != 0 && config->continuation_window_ms != 0
+                           ? config->continuation_window_ms
+                           : config->partial_line_timeout_ms / 2 + 1;
+        }
+        backend.semaphore_take(wake_sem, interval);
+        stopping = !running.load(std::memory_order_acquire);
+#if CONFIG_LOGGABLE_ESPIDF_SELF_REPORT
+        const int64_t busy_start = esp_timer_get_time();
+#endif
+#if CONFIG_LOGGABLE_ESPIDF_TRACE_EVENTS
+        PipelineTrace::instant("drain_wake");
+        {
+            PipelineTraceScope trace_scope("drain");
+            drain_entries();
+        }
+#else
+        drain_entries();
+#endif
+        if (esp_log_timestamp() - last_sweep >= interval) {
+            sweep_task_contexts();
+            last_sweep = esp_log_timestamp();
+        }
+        report_drops();
+#if CONFIG_LOGGABLE_ESPIDF_MEMORY_GOVERNOR
+        governor_poll();
+#endif
+        reclaim_retired_sinks();
+        reclaim_retired_configs();
+#if CONFIG_LOGGABLE_ESPIDF_SELF_REPORT
+        note_drain_busy(static_cast<uint32_t>(esp_timer_get_time() - busy_start));
+#endif
+    }
+    sweep_task_contexts(true);
+
+    drain_task.store(nullptr, std::memory_order_release);
+    backend.semaphore_give(done_sem);
+    backend.task_delete(os::TaskHandle{nullptr});
+}
+
+} // namespace
+
+bool capture_running() noexcept {
+    return running.load(std::memory_order_acquire);
+}
+
+bool on_drain_task() noexcept {
+    return xTaskGetCurrentTaskHandle() == drain_task.load(std::memory_order_acquire);
+}
+
+bool capture_start() noexcept {
+    constexpr size_t capacity = CONFIG_LOGGABLE_ESPIDF_CAPTURE_BUFFER_SIZE;
+    if (capacity == 0 || running.load(std::memory_order_acquire)) {
+        return running.load(std::memory_order_acquire);
+    }
+
+    auto& backend = os::get_freertos_backend();
+    ring = new (std::nothrow) uint8_t[capacity];
+    wake_sem = backend.semaphore_create_binary();
+    done_sem = backend.semaphore_create_binary();
+    if (ring && wake_sem && done_sem) {
+        ring_capacity = capacity;
+        ring_head = ring_tail = ring_used = high_water = 0;
+        fair_share = capacity / CONFIG_LOGGABLE_ESPIDF_CAPTURE_FAIR_SHARES;
+        reserved = 0;
+        std::memset(credits, 0, sizeof(credits));
+        dropped_lines = dropped_bytes = 0;
+        running.store(true, std::memory_order_release);
+
+        os::TaskConfig config;
+        config.name = "loggable_drain";
+        config.stack_size = CONFIG_LOGGABLE_ESPIDF_DRAIN_TASK_STACK;
+        config.priority = CONFIG_LOGGABLE_ESPIDF_DRAIN_TASK_PRIORITY;
+        config.core = -1;
+        if (backend.task_create(config, &drain_main, nullptr)) {
+            return true;
+        }
+        running.store(false, std::memory_order_release);
+    }
+
+    backend.semaphore_destroy(wake_sem);
+    backend.semaphore_destroy(done_sem);
+    wake_sem = done_sem = os::SemaphoreHandle{nullptr};
+    delete[] ring;
+    ring = nullptr;
+    return false;
+}
+
+void capture_stop() noexcept {
+    if (!running.exchange(false, std::memory_order_acq_rel)) {
+        return;
+    }
+    auto& backend = os::get_freertos_backend();
+    backend.semaphore_give(wake_sem);
+    while (!backend.semaphore_take(done_sem, 1000)) {
+    }
+
+    // Producers that raced with the stop see a null ring under the lock and
+    // fall back to synchronous dispatch.
+    const auto lock = lock_ring();
+    delete[] ring;
+    ring = nullptr;
+    ring_capacity = 0;
+    backend.semaphore_destroy(wake_sem);
+    backend.semaphore_destroy(done_sem);
+    wake_sem = done_sem = os::SemaphoreHandle{nullptr};
+}
+
+bool capture_resize(size_t capacity) noexcept {
+    const auto lock = lock_ring();
+    if (!running.load(std::memory_order_acquire) || ring_used != 0 || capacity == 0) {
+        return false;
+    }
+    if (ring && capacity == ring_capacity) {
+        return true;
+    }
+    uint8_t* next = new (std::nothrow) uint8_t[capacity];
+    if (!next) {
+        if (ring && capacity > ring_capacity) {
+            return false;
+        }
+        delete[] ring;
+        ring = nullptr;
+        ring_capacity = 0;
+        next = new (std::nothrow) uint8_t[capacity];
+        if (!next) {
+            return false;
+        }
+    }
+    delete[] ring;
+    ring = next;
+    ring_capacity = capacity;
+    ring_head = ring_tail = 0;
+    fair_share = capacity / CONFIG_LOGGABLE_ESPIDF_CAPTURE_FAIR_SHARES;
+    reserved = 0;
+    return true;
+}
+
+size_t capture_capacity() noexcept {
+    const auto lock = lock_ring();
+    return ring_capacity;
+}
+
+size_t capture_pending() noexcept {
+    const auto lock = lock_ring();
+    return ring_used;
+}
+
+size_t capture_high_water(bool reset) noexcept {
+    const auto lock = lock_ring();
+    const size_t peak = high_water;
+    if (reset) {
+        high_water = ring_used;
+    }
+    return peak;
+}
+
+CaptureContention capture_contention(bool reset) noexcept {
+    if constexpr (!CONFIG_LOGGABLE_ESPIDF_LOCK_COUNTERS) {
+        return {};
+    }
+    const auto lock = lock_ring();
+    const CaptureContention contention{ring_acquisitions, ring_contentions};
+    if (reset) {
+        ring_acquisitions = ring_contentions = 0;
+    }
+    return contention;
+}
+
+uint32_t capture_dropped_total() noexcept {
+    return dropped_total.load(std::memory_order_relaxed);
+}
+
+void capture_trim() noexcept {
+    drain_message.shrink();
+}
+
+bool capture_line(std::string_view line, const LineOrigin& origin) noexcept {
+    return enqueue(kCapturedLine, origin, &line, 1);
+}
+
+bool capture_blob(const BlobInfo& info, std::string_view data, const LineOrigin& origin) noexcept {
+    const std::string_view tag = info.tag.substr(0, UINT8_MAX);
+    const CapturedBlob blob{info.address, static_cast<uint8_t>(info.level), static_cast<uint8_t>(info.format),
+                            static_cast<uint8_t>(tag.size()), 0};
+    const std::string_view parts[] = {
+        std::string_view(reinterpret_cast<const char*>(&blob), sizeof(blob)),
+        tag,
+        data,
+    };
+    return enqueue(kCapturedBlob, origin, parts, 3);
+}
+
+bool capture_formatted(const FormattedInfo& info, std::string_view args, const LineOrigin& origin) noexcept {
+    const std::string_view tag = info.tag.substr(0, UINT8_MAX);
+    const CapturedFormat entry{info.format, static_cast<uint8_t>(info.level), static_cast<uint8_t>(tag.size()), 0};
+    const std::string_view parts[] = {
+        std::string_view(reinterpret_cast<const char*>(&entry), sizeof(entry)),
+        tag,
+        args,
+    };
+    return enqueue(kCapturedFormat, origin, parts, 3);
+}
+
+} // namespace detail
+} // namespace espidf
+} // namespace loggable
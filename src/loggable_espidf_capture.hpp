@@ -0,0 +1,340 @@
+#pragma once
+
+#include "loggable.hpp"
+#include "loggable_espidf.hpp"
+#include "loggable_espidf_latency.hpp"
+#include "loggable_espidf_rcu.hpp"
+#include <esp_log.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+#include <string_view>
+
+#ifndef CONFIG_LOGGABLE_ESPIDF_CAPTURE_BUFFER_SIZE
+#define CONFIG_LOGGABLE_ESPIDF_CAPTURE_BUFFER_SIZE 8192
+#endif
+
+#ifndef CONFIG_LOGGABLE_ESPIDF_CAPTURE_FAIR_SHARES
+#define CONFIG_LOGGABLE_ESPIDF_CAPTURE_FAIR_SHARES 8
+#endif
+
+#ifndef CONFIG_LOGGABLE_ESPIDF_DRAIN_BATCH_BYTES
+#define CONFIG_LOGGABLE_ESPIDF_DRAIN_BATCH_BYTES 2048
+#endif
+
+#ifndef CONFIG_LOGGABLE_ESPIDF_QUIESCE_TIMEOUT_MS
+#define CONFIG_LOGGABLE_ESPIDF_QUIESCE_TIMEOUT_MS 1000
+#endif
+
+#ifndef CONFIG_LOGGABLE_ESPIDF_DRAIN_TASK_STACK
+#define CONFIG_LOGGABLE_ESPIDF_DRAIN_TASK_STACK 4096
+#endif
+
+#ifndef CONFIG_LOGGABLE_ESPIDF_DRAIN_TASK_PRIORITY
+#define CONFIG_LOGGABLE_ESPIDF_DRAIN_TASK_PRIORITY 3
+#endif
+
+#ifndef CONFIG_LOGGABLE_ESPIDF_TRACE_EVENTS
+#define CONFIG_LOGGABLE_ESPIDF_TRACE_EVENTS 0
+#endif
+
+#ifndef CONFIG_LOGGABLE_ESPIDF_LOCK_COUNTERS
+#define CONFIG_LOGGABLE_ESPIDF_LOCK_COUNTERS 0
+#endif
+
+namespace loggable {
+namespace espidf {
+namespace detail {
+
+/// Identity of the task that completed a line.
+struct LineOrigin {
+    uint16_t task_id;
+    uint8_t core;
+    std::chrono::system_clock::time_point captured;  ///< Used when the line has no ESP-IDF timestamp.
+    [[no_unique_address]] LatencyStamps stamps{};
+};
+
+/**
+ * @brief Tracks hook invocations in flight.
+ *
+ * Every entry into the hook, and into anything else that uses the capture
+ * pipeline or the Sinker on behalf of a producer, is a read section;
+ * uninstall waits for a grace period before tearing the pipeline down.
+ * Defined in loggable_espidf.cpp.
+ */
+extern RcuDomain hook_rcu;
+
+/**
+ * @brief Capture buffer entry as popped by the drain task.
+ *
+ * A fixed, cache-line-multiple record that holds entries of up to
+ * kInlineCapacity bytes, which covers most ESP-IDF lines, inline. Longer
+ * entries go to a heap buffer that is kept for the next one, so a drain
+ * task reusing one message only allocates when the longest entry so far
+ * grows. Parsing yields views into the storage, so nothing is copied until
+ * a LogMessage is needed.
+ */
+class alignas(32) CapturedMessage {
+public:
+    static constexpr size_t kSize = 128;
+    /// What remains of kSize after the bookkeeping fields.
+    static constexpr size_t kInlineCapacity = kSize - sizeof(char*) * 2 - sizeof(size_t) * 2;
+
+    CapturedMessage() noexcept = default;
+    CapturedMessage(const CapturedMessage&) = delete;
+    CapturedMessage& operator=(const CapturedMessage&) = delete;
+    ~CapturedMessage() { delete[] _heap; }
+
+    /**
+     * @brief Make room for `size` bytes, discarding the current contents.
+     * @return Storage for the entry, or nullptr if it could not be allocated.
+     */
+    char* prepare(size_t size) noexcept {
+        _size = 0;
+        if (size <= sizeof(_inline)) {
+            _data = _inline;
+        } else {
+            if (size > _heap_capacity) {
+                delete[] _heap;
+                _heap = new (std::nothrow) char[size];
+                _heap_capacity = _heap ? size : 0;
+                if (!_heap) {
+                    return nullptr;
+                }
+            }
+            _data = _heap;
+        }
+        _size = size;
+        return _data;
+    }
+
+    std::string_view view() const noexcept { return {_data, _size}; }
+
+    /// Free the heap buffer; the next long entry allocates again.
+    void shrink() noexcept {
+        if (_data == _heap) {
+            _data = _inline;
+            _size = 0;
+        }
+        delete[] _heap;
+        _heap = nullptr;
+        _heap_capacity = 0;
+    }
+
+private:
+    char* _data = _inline;
+    size_t _size = 0;
+    char* _heap = nullptr;
+    size_t _heap_capacity = 0;
+    char _inline[kInlineCapacity];
+};
+
+static_assert(sizeof(CapturedMessage) == CapturedMessage::kSize, "CapturedMessage must span whole cache lines");
+
+/// Description of a captured binary buffer.
+struct BlobInfo {
+    esp_log_level_t level;
+    BlobFormat format;
+    uint32_t address;  ///< Address of the original buffer, shown in hex dumps.
+    std::string_view tag;
+};
+
+/// Map an ESP-IDF level to the loggable level.
+inline LogLevel to_log_level(esp_log_level_t level) noexcept {
+    switch (level) {
+        case ESP_LOG_ERROR: return LogLevel::Error;
+        case ESP_LOG_WARN: return LogLevel::Warning;
+        case ESP_LOG_DEBUG: return LogLevel::Debug;
+        case ESP_LOG_VERBOSE: return LogLevel::Verbose;
+        default: return LogLevel::Info;
+    }
+}
+
+/// Description of a record logged with loggable::espidf::log().
+struct FormattedInfo {
+    esp_log_level_t level;
+    const char* format;  ///< String literal, checked at compile time.
+    std::string_view tag;
+};
+
+/**
+ * @brief Parse an ESP-IDF line and deliver it to the Sinker and record sinks.
+ *
+ * Defined in loggable_espidf.cpp.
+ */
+void dispatch_line(std::string_view line, const LineOrigin& origin);
+
+/**
+ * @brief Deliver an already parsed record to the Sinker and record sinks.
+ *
+ * Record sinks see the views as they are; the Sinker's LogMessage, which
+ * owns its strings, is only built when the Sinker is routed to. Defined in
+ * loggable_espidf.cpp.
+ */
+void deliver(std::chrono::system_clock::time_point timestamp, LogLevel level, std::string_view tag,
+             std::string_view payload, const LineOrigin& origin);
+
+/**
+ * @brief Deliver a binary buffer.
+ *
+ * Record sinks receive the bytes verbatim; the Sinker, which only deals in
+ * text, receives them rendered with render_blob(). Defined in
+ * loggable_espidf.cpp.
+ */
+void deliver_blob(const BlobInfo& info, std::string_view data, const LineOrigin& origin);
+
+/**
+ * @brief Format a serialized record and deliver it, mirroring it to the
+ *        console if the hook does.
+ *
+ * Defined in loggable_espidf_format.cpp.
+ */
+void deliver_formatted(const FormattedInfo& info, std::string_view args, const LineOrigin& origin);
+
+/**
+ * @brief Print to the vprintf handler that was active before install.
+ *
+ * Defined in loggable_espidf.cpp.
+ */
+void console_printf(const char* format, ...) noexcept;
+
+/**
+ * @brief Commit a record completed outside the hook.
+ *
+ * Used for held records and partial lines flushed by the sweeper or left
+ * behind by deleted tasks. Takes the same path as records the hook commits:
+ * volume accounting, counters and latency stamps. Defined in
+ * loggable_espidf.cpp.
+ *
+ * @param cycles Formatting cycles of the record's fragments.
+ */
+void flush_line(std::string& line, const LineOrigin& origin, uint32_t cycles);
+
+/**
+ * @brief Check whether the drain task is running.
+ */
+bool capture_running() noexcept;
+
+/**
+ * @brief Check whether the calling task is the drain task.
+ */
+bool on_drain_task() noexcept;
+
+/**
+ * @brief Allocate the capture buffer and start the drain task.
+ * @return false if capture is disabled or could not be started; lines are
+ *         then dispatched synchronously by the hook.
+ */
+bool capture_start() noexcept;
+
+/**
+ * @brief Drain the remaining lines, stop the drain task and free the buffer.
+ */
+void capture_stop() noexcept;
+
+/**
+ * @brief Reallocate the capture buffer with a new capacity.
+ *
+ * Only possible while the buffer is empty, and only from the drain task.
+ * If the new buffer cannot be allocated a larger existing one is kept;
+ * when shrinking, the old buffer is freed first, and if even the smaller
+ * one cannot be had, producers fall back to synchronous dispatch until a
+ * later resize succeeds.
+ *
+ * @return false if the buffer was not empty or could not be allocated.
+ */
+bool capture_resize(size_t capacity) noexcept;
+
+/// Current capacity of the capture buffer in bytes.
+size_t capture_capacity() noexcept;
+
+/// Bytes queued in the capture buffer and not yet popped by the drain task.
+size_t capture_pending() noexcept;
+
+/**
+ * @brief Most bytes queued in the capture buffer at once.
+ * @param reset Restart tracking from the current fill level.
+ */
+size_t capture_high_water(bool reset = false) noexcept;
+
+/// Acquisitions of the capture buffer lock by producers, the drain task and
+/// every other reader or writer of the ring, these counters included.
+struct CaptureContention {
+    uint32_t acquisitions;
+    uint32_t contended;  ///< Acquisitions that found the lock taken and waited.
+};
+
+/// Read, and optionally reset, the capture lock counters; zeros without LOGGABLE_ESPIDF_LOCK_COUNTERS.
+CaptureContention capture_contention(bool reset = false) noexcept;
+
+/**
+ * @brief Lines dropped because the capture buffer was full, since boot.
+ *
+ * Unlike the drop report this is never reset, so callers measure a window
+ * by taking the difference.
+ */
+uint32_t capture_dropped_total() noexcept;
+
+/**
+ * @brief Free the drain task's spare buffers. Drain task only.
+ */
+void capture_trim() noexcept;
+
+/**
+ * @brief Queue a complete line for the drain task.
+ *
+ * Each producer is guaranteed `1 / CONFIG_LOGGABLE_ESPIDF_CAPTURE_FAIR_SHARES`
+ * of the buffer. Beyond that it may borrow free space only while enough is
+ * left to honour the guarantee of every other producer, so a flooding task
+ * drops its own lines instead of starving the rest. Drops are charged to the
+ * producer and reported by the drain task.
+ *
+ * Producers are tracked in `CONFIG_LOGGABLE_ESPIDF_TASK_NAMES` credit slots,
+ * one per task with lines in flight or drops not yet reported. A producer
+ * that finds every slot taken by others gets no guaranteed share: it may
+ * only borrow, and its drops count in the total but are not named.
+ *
+ * @return false if capture is not running and the caller must dispatch the
+ *         line itself; true if the line was queued or dropped.
+ */
+bool capture_line(std::string_view line, const LineOrigin& origin) noexcept;
+
+/**
+ * @brief Queue a binary buffer for the drain task as a single entry.
+ *
+ * Subject to the same fair share as lines.
+ *
+ * @return false if capture is not running and the caller must deliver the
+ *         buffer itself.
+ */
+bool capture_blob(const BlobInfo& info, std::string_view data, const LineOrigin& origin) noexcept;
+
+/**
+ * @brief Queue a serialized fmt-style record; it is formatted by the drain task.
+ *
+ * Subject to the same fair share as lines.
+ *
+ * @return false if capture is not running and the caller must deliver the
+ *         record itself.
+ */
+bool capture_formatted(const FormattedInfo& info, std::string_view args, const LineOrigin& origin) noexcept;
+
+/**
+ * @brief Free record sink snapshots retired while a sink was dispatching.
+ *
+ * Called by the drain task between batches. Defined in loggable_espidf.cpp.
+ */
+void reclaim_retired_sinks() noexcept;
+
+/**
+ * @brief Check whether the hook mirrors output to the original vprintf.
+ *
+ * Defined in loggable_espidf.cpp.
+ */
+bool mirrors_to_console() noexcept;
+
+} // namespace detail
+} // namespace espidf
+} // namespace loggable
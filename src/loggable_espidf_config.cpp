@@ -0,0 +1,143 @@
+#include "loggable_espidf_config.hpp"
+#include "loggable_espidf_task.hpp"
+#include <algorithm>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace loggable {
+namespace espidf {
+namespace detail {
+
+namespace {
+
+// Kconfig defaults; in use until the first configure() and never freed.
+static const HookConfig default_config{};
+
+static std::mutex config_mutex;
+// What configure() was last given, i.e. the published configuration.
+static HookConfig requested_config{};
+static std::vector<const HookConfig*> retired_configs;
+static std::atomic<bool> configs_retired{false};
+static std::atomic<uint32_t> rate_limited_lines{0};
+
+/// Free retired configurations once no reader can see them. Called with config_mutex held.
+void reclaim_configs() {
+    const TaskContext* ctx = find_task_context();
+    if (retired_configs.empty() || (ctx && ctx->sink_dispatch_depth != 0)) {
+        // A sink reconfiguring from its dispatch may itself be inside the
+        // hook; waiting here would never end, so the drain task reclaims.
+        return;
+    }
+    if (!hook_rcu.synchronize(CONFIG_LOGGABLE_ESPIDF_QUIESCE_TIMEOUT_MS)) {
+        return;
+    }
+    for (const HookConfig* retired : retired_configs) {
+        delete retired;
+    }
+    retired_configs.clear();
+    configs_retired.store(false, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Mirror the level filters and the governor's cap into level_index.
+ *
+ * Called with config_mutex held. Without LOGGABLE_ESPIDF_HOOK_FILTERS the
+ * hook ignores the configured ceilings, and so does LogHook::enabled(); only
+ * the cap is mirrored.
+ */
+void publish_level_index(const HookConfig& config) {
+    const uint8_t cap = level_cap.load(std::memory_order_relaxed);
+    const bool filters = CONFIG_LOGGABLE_ESPIDF_HOOK_FILTERS;
+    const uint8_t max_level = filters ? std::min(static_cast<uint8_t>(config.max_level), cap) : cap;
+    const uint32_t sequence = level_index.sequence.load(std::memory_order_relaxed);
+    level_index.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    level_index.max_level.store(max_level, std::memory_order_relaxed);
+    level_index.tag_count.store(filters ? config.tag_levels.count : 0, std::memory_order_relaxed);
+    if (filters) {
+        for (size_t i = 0; i < kTagLevelSlots; ++i) {
+            level_index.hashes[i].store(config.tag_levels.hashes[i], std::memory_order_relaxed);
+            level_index.levels[i].store(config.tag_levels.levels[i], std::memory_order_relaxed);
+        }
+    }
+    level_index.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+/// Publish a configuration. Called with config_mutex held.
+bool publish_config(const HookConfig& requested) {
+    auto* next = new (std::nothrow) HookConfig(requested);
+    if (!next) {
+        return false;
+    }
+    const HookConfig* previous = active_config.exchange(next, std::memory_order_acq_rel);
+    publish_level_index(*next);
+    if (previous != &default_config) {
+        retired_configs.push_back(previous);
+        configs_retired.store(true, std::memory_order_relaxed);
+    }
+    reclaim_configs();
+    return true;
+}
+
+} // namespace
+
+LevelIndex level_index;
+std::atomic<const HookConfig*> active_config{&default_config};
+std::atomic<uint8_t> level_cap{ESP_LOG_VERBOSE};
+
+void count_rate_limited() noexcept {
+    rate_limited_lines.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint32_t take_rate_limited() noexcept {
+    return rate_limited_lines.exchange(0, std::memory_order_relaxed);
+}
+
+bool config_level_enabled(const char* tag, esp_log_level_t level) noexcept {
+    if (!level_cap_allows(level)) {
+        return false;
+    }
+    if (!CONFIG_LOGGABLE_ESPIDF_HOOK_FILTERS) {
+        return true;
+    }
+    ConfigGuard config;
+    return level <= config->max_level &&
+           (!tag || config->tag_levels.count == 0 || level <= config->tag_levels.find(tag, ESP_LOG_VERBOSE));
+}
+
+void set_level_cap(esp_log_level_t level) noexcept {
+    std::lock_guard<std::mutex> lock(config_mutex);
+    level_cap.store(static_cast<uint8_t>(level), std::memory_order_relaxed);
+    publish_level_index(*active_config.load(std::memory_order_relaxed));
+}
+
+void reclaim_retired_configs() noexcept {
+    if (configs_retired.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(config_mutex);
+        reclaim_configs();
+    }
+}
+
+} // namespace detail
+
+bool LogHook::configure(const HookConfig& config) noexcept {
+    {
+        std::lock_guard<std::mutex> lock(detail::config_mutex);
+        if (!detail::publish_config(config)) {
+            return false;
+        }
+        detail::requested_config = config;
+    }
+    // Outside config_mutex so it never nests with the hook swap lock.
+    detail::reselect_hook();
+    return true;
+}
+
+HookConfig LogHook::config() noexcept {
+    std::lock_guard<std::mutex> lock(detail::config_mutex);
+    return detail::requested_config;
+}
+
+} // namespace espidf
+} // namespace loggable
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "loggable_espidf.hpp"
+#include "loggable_espidf_capture.hpp"
+#include "loggable_espidf_rcu.hpp"
+#include <atomic>
+#include <cstdint>
+
+#ifndef CONFIG_LOGGABLE_ESPIDF_HOOK_FILTERS
+#define CONFIG_LOGGABLE_ESPIDF_HOOK_FILTERS 0
+#endif
+
+#ifndef CONFIG_LOGGABLE_ESPIDF_HOOK_RATE_LIMIT
+#define CONFIG_LOGGABLE_ESPIDF_HOOK_RATE_LIMIT 0
+#endif
+
+namespace loggable {
+namespace espidf {
+namespace detail {
+
+/**
+ * @brief The active configuration.
+ *
+ * Never null. Replaced by LogHook::configure(); the previous one is freed
+ * once no read section of hook_rcu can still be using it.
+ */
+extern std::atomic<const HookConfig*> active_config;
+
+/**
+ * @brief Get the active configuration.
+ *
+ * The caller must be inside a read section of hook_rcu, as the hook is, and
+ * must not keep the reference past it.
+ */
+inline const HookConfig& config() noexcept {
+    return *active_config.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief Read section pinning the active configuration.
+ *
+ * For code that runs outside the hook, such as the drain task.
+ */
+class ConfigGuard {
+public:
+    ConfigGuard() noexcept : _guard(hook_rcu), _config(config()) {}
+
+    const HookConfig& operator*() const noexcept { return _config; }
+    const HookConfig* operator->() const noexcept { return &_config; }
+
+private:
+    RcuReadGuard _guard;
+    const HookConfig& _config;
+};
+
+/**
+ * @brief Set the memory governor's level cap.
+ *
+ * Stores level_cap and mirrors it into level_index for LogHook::enabled();
+ * allocates nothing, so it is safe under memory pressure. The configuration
+ * is left as requested.
+ */
+void set_level_cap(esp_log_level_t level) noexcept;
+
+/**
+ * @brief Count a line dropped by the per-task rate limit.
+ */
+void count_rate_limited() noexcept;
+
+/**
+ * @brief Take the number of rate limited lines since the last call.
+ */
+uint32_t take_rate_limited() noexcept;
+
+/**
+ * @brief Switch to the hook variant matching the active configuration.
+ *
+ * Called by LogHook::configure() after publishing. Defined in
+ * loggable_espidf.cpp.
+ */
+void reselect_hook() noexcept;
+
+/**
+ * @brief Free configurations replaced while a sink was dispatching.
+ *
+ * Called by the drain task between batches.
+ */
+void reclaim_retired_configs() noexcept;
+
+} // namespace detail
+} // namespace espidf
+} // namespace loggable
@@ -0,0 +1,199 @@
+#include "loggable_espidf_format.hpp"
+#include "loggable_espidf_capture.hpp"
+#include "loggable_espidf_config.hpp"
+#include "loggable_espidf_stats.hpp"
+#include "loggable_espidf_task.hpp"
+#include <esp_log.h>
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <string>
+
+namespace loggable {
+namespace espidf {
+namespace detail {
+
+namespace {
+
+/// Read one serialized argument and append it as text using `spec`.
+bool append_arg(std::string_view spec, const uint8_t*& args, const uint8_t* end, std::string& out) {
+    if (args >= end) {
+        return false;
+    }
+    const auto type = static_cast<ArgType>(*args++);
+    const bool hex = !spec.empty() && (spec.back() == 'x' || spec.back() == 'X');
+    const bool upper = hex && spec.back() == 'X';
+    char text[48];
+    int length = 0;
+
+    auto take = [&](auto& value) {
+        if (end - args < static_cast<ptrdiff_t>(sizeof(value))) {
+            return false;
+        }
+        std::memcpy(&value, args, sizeof(value));
+        args += sizeof(value);
+        return true;
+    };
+
+    switch (type) {
+        case ArgType::Bool:
+        case ArgType::Char:
+        case ArgType::Int:
+        case ArgType::UInt: {
+            uint32_t value;
+            if (!take(value)) {
+                return false;
+            }
+            if (type == ArgType::Bool) {
+                out += value ? "true" : "false";
+                return true;
+            }
+            if (type == ArgType::Char && !hex) {
+                out += static_cast<char>(value);
+                return true;
+            }
+            if (hex) {
+                length = std::snprintf(text, sizeof(text), upper ? "%" PRIX32 : "%" PRIx32, value);
+            } else if (type == ArgType::Int) {
+                length = std::snprintf(text, sizeof(text), "%" PRId32, static_cast<int32_t>(value));
+            } else {
+                length = std::snprintf(text, sizeof(text), "%" PRIu32, value);
+            }
+            break;
+        }
+        case ArgType::Int64:
+        case ArgType::UInt64: {
+            uint64_t value;
+            if (!take(value)) {
+                return false;
+            }
+            if (hex) {
+                length = std::snprintf(text, sizeof(text), upper ? "%" PRIX64 : "%" PRIx64, value);
+            } else if (type == ArgType::Int64) {
+                length = std::snprintf(text, sizeof(text), "%" PRId64, static_cast<int64_t>(value));
+            } else {
+                length = std::snprintf(text, sizeof(text), "%" PRIu64, value);
+            }
+            break;
+        }
+        case ArgType::Double: {
+            double value;
+            if (!take(value)) {
+                return false;
+            }
+            int precision = -1;
+            if (spec.size() > 1 && spec[0] == '.') {
+                precision = 0;
+                for (size_t i = 1; i < spec.size() && spec[i] >= '0' && spec[i] <= '9'; ++i) {
+                    precision = precision * 10 + (spec[i] - '0');
+                }
+            }
+            length = precision < 0 ? std::snprintf(text, sizeof(text), "%g", value)
+                                   : std::snprintf(text, sizeof(text), "%.*f", precision, value);
+            break;
+        }
+        case ArgType::String: {
+            uint16_t size;
+            if (!take(size) || end - args < size) {
+                return false;
+            }
+            out.append(reinterpret_cast<const char*>(args), size);
+            args += size;
+            return true;
+        }
+        case ArgType::Pointer: {
+            uintptr_t value;
+            if (!take(value)) {
+                return false;
+            }
+            length = std::snprintf(text, sizeof(text), "0x%" PRIxPTR, value);
+            break;
+        }
+        default:
+            return false;
+    }
+    out.append(text, length > 0 ? std::min<size_t>(length, sizeof(text) - 1) : 0);
+    return true;
+}
+
+} // namespace
+
+void format_args(std::string_view format, const uint8_t* args, size_t size, std::string& out) {
+    const uint8_t* end = args + size;
+    for (size_t i = 0; i < format.size(); ++i) {
+        const char c = format[i];
+        if ((c == '{' || c == '}') && i + 1 < format.size() && format[i + 1] == c) {
+            out += c;
+            ++i;
+        } else if (c == '{') {
+            const size_t close = format.find('}', i);
+            std::string_view spec = format.substr(i + 1, close - i - 1);
+            if (!spec.empty() && spec[0] == ':') {
+                spec.remove_prefix(1);
+            }
+            if (!append_arg(spec, args, end, out)) {
+                out += "{?}";
+                args = end;
+            }
+            i = close;
+        } else {
+            out += c;
+        }
+    }
+}
+
+void deliver_formatted(const FormattedInfo& info, std::string_view args, const LineOrigin& origin) {
+    std::string text;
+    format_args(info.format, reinterpret_cast<const uint8_t*>(args.data()), args.size(), text);
+
+    if (mirrors_to_console()) {
+        static constexpr char kLetters[] = "NEWIDV";
+        const uint32_t millis = static_cast<uint32_t>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(origin.captured.time_since_epoch()).count());
+        console_printf("%c (%" PRIu32 ") %.*s: %s\n", kLetters[info.level <= ESP_LOG_VERBOSE ? info.level : 0], millis,
+                       static_cast<int>(info.tag.size()), info.tag.data(), text.c_str());
+    }
+    deliver(origin.captured, to_log_level(info.level), info.tag, text, origin);
+}
+
+void emit_formatted(esp_log_level_t level, const char* tag, const char* format, const uint8_t* args,
+                    size_t size) noexcept {
+    tag = tag ? tag : "";
+    if (level > esp_log_level_get(tag) || !level_cap_allows(level)) {
+        return;
+    }
+    RcuReadGuard in_flight(hook_rcu);
+    if (!LogHook::is_installed()) {
+        std::string text;
+        format_args(format, args, size, text);
+        esp_log_write(level, tag, "%c (%" PRIu32 ") %s: %s\n", "NEWIDV"[level <= ESP_LOG_VERBOSE ? level : 0],
+                      esp_log_timestamp(), tag, text.c_str());
+        return;
+    }
+    // A sink logging from a synchronous delivery would re-enter here.
+    ReentryGuard reentry;
+    if (!reentry) {
+        return;
+    }
+    TaskContext* ctx = get_task_context();
+    if (!ctx || ctx->capture_suppressed) {
+        return;
+    }
+
+    const FormattedInfo info{level, format, tag};
+    const std::string_view bytes(reinterpret_cast<const char*>(args), size);
+    // ESP-IDF's timestamp, so records order with captured lines.
+    const LineOrigin origin{ctx->task_id, static_cast<uint8_t>(xPortGetCoreID()),
+                            std::chrono::system_clock::time_point(std::chrono::milliseconds(esp_log_timestamp()))};
+#if CONFIG_LOGGABLE_ESPIDF_VOLUME_STATS
+    account_record(ctx->task_id, info.tag, size, 0);
+#endif
+    if (!config().async_capture || !capture_formatted(info, bytes, origin)) {
+        deliver_formatted(info, bytes, origin);
+    }
+}
+
+} // namespace detail
+} // namespace espidf
+} // namespace loggable
@@ -0,0 +1,109 @@
+#include "loggable_espidf_governor.hpp"
+#include "loggable_espidf_capture.hpp"
+#include "loggable_espidf_config.hpp"
+#include "loggable_espidf_task.hpp"
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+
+namespace loggable {
+namespace espidf {
+namespace detail {
+
+namespace {
+
+constexpr uint32_t kHeapCaps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+constexpr uint32_t kPollIntervalMs = 100;
+constexpr size_t kFullCapacity = CONFIG_LOGGABLE_ESPIDF_CAPTURE_BUFFER_SIZE;
+constexpr size_t kPressureCapacity = kFullCapacity / 4;
+
+static std::atomic<bool> under_pressure{false};
+static std::atomic<bool> alloc_failed{false};
+static uint32_t last_poll_ms = 0;
+// Target capacity not reached yet because the buffer was not empty.
+static size_t pending_capacity = 0;
+
+void on_alloc_failed(size_t, uint32_t caps, const char*) {
+    if ((caps & MALLOC_CAP_INTERNAL) != 0 || (caps & MALLOC_CAP_8BIT) != 0) {
+        alloc_failed.store(true, std::memory_order_relaxed);
+    }
+}
+
+void report(LogLevel level, const char* text) {
+    const LineOrigin origin{0, static_cast<uint8_t>(xPortGetCoreID()), std::chrono::system_clock::now()};
+    deliver(origin.captured, level, "loggable", text, origin);
+}
+
+void resize_to(size_t capacity) {
+    pending_capacity = capture_resize(capacity) ? 0 : capacity;
+}
+
+void enter_pressure(size_t free_bytes, bool failed) {
+    under_pressure.store(true, std::memory_order_relaxed);
+    set_level_cap(ESP_LOG_INFO);
+    capture_trim();
+    trim_task_buffers();
+    const size_t previous = capture_capacity();
+    resize_to(kPressureCapacity);
+
+    char text[160];
+    std::snprintf(text, sizeof(text),
+                  "memory pressure: %u bytes free%s; dropping Debug/Verbose, capture buffer %u -> %u bytes%s",
+                  static_cast<unsigned>(free_bytes), failed ? " after a failed allocation" : "",
+                  static_cast<unsigned>(previous), static_cast<unsigned>(kPressureCapacity),
+                  pending_capacity ? " once drained" : "");
+    report(LogLevel::Warning, text);
+}
+
+void leave_pressure(size_t free_bytes) {
+    under_pressure.store(false, std::memory_order_relaxed);
+    set_level_cap(ESP_LOG_VERBOSE);
+    resize_to(kFullCapacity);
+
+    char text[128];
+    std::snprintf(text, sizeof(text), "memory pressure over: %u bytes free; all levels, capture buffer %u bytes%s",
+                  static_cast<unsigned>(free_bytes), static_cast<unsigned>(kFullCapacity),
+                  pending_capacity ? " once drained" : "");
+    report(LogLevel::Info, text);
+}
+
+} // namespace
+
+void governor_start() noexcept {
+#if CONFIG_LOGGABLE_ESPIDF_GOVERNOR_FAILED_ALLOC_HOOK
+    static bool registered = false;
+    if (!registered) {
+        registered = heap_caps_register_failed_alloc_callback(&on_alloc_failed) == ESP_OK;
+    }
+#endif
+}
+
+void governor_poll() noexcept {
+    const uint32_t now = esp_log_timestamp();
+    const bool failed = alloc_failed.exchange(false, std::memory_order_relaxed);
+    if (!failed && now - last_poll_ms < kPollIntervalMs) {
+        return;
+    }
+    last_poll_ms = now;
+
+    const size_t free_bytes = heap_caps_get_free_size(kHeapCaps);
+    const bool pressure = under_pressure.load(std::memory_order_relaxed);
+    if (!pressure && (failed || free_bytes < CONFIG_LOGGABLE_ESPIDF_GOVERNOR_LOW_WATERMARK)) {
+        enter_pressure(free_bytes, failed);
+    } else if (pressure && !failed && free_bytes > CONFIG_LOGGABLE_ESPIDF_GOVERNOR_HIGH_WATERMARK) {
+        leave_pressure(free_bytes);
+    } else if (pending_capacity != 0) {
+        resize_to(pending_capacity);
+    }
+}
+
+} // namespace detail
+
+bool LogHook::under_memory_pressure() noexcept {
+    return detail::under_pressure.load(std::memory_order_relaxed);
+}
+
+} // namespace espidf
+} // namespace loggable
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "loggable_espidf.hpp"
+
+#ifndef CONFIG_LOGGABLE_ESPIDF_GOVERNOR_LOW_WATERMARK
+#define CONFIG_LOGGABLE_ESPIDF_GOVERNOR_LOW_WATERMARK 16384
+#endif
+
+#ifndef CONFIG_LOGGABLE_ESPIDF_GOVERNOR_HIGH_WATERMARK
+#define CONFIG_LOGGABLE_ESPIDF_GOVERNOR_HIGH_WATERMARK 32768
+#endif
+
+namespace loggable {
+namespace espidf {
+namespace detail {
+
+/**
+ * @brief Check the internal heap and enter or leave low-memory mode.
+ *
+ * Under pressure (free internal heap below the low watermark, or a failed
+ * allocation reported since the last poll) Debug and Verbose lines are
+ * dropped, spare buffers are freed and the capture buffer is shrunk to a
+ * quarter; all of it is undone once free heap is back above the high
+ * watermark. Transitions are delivered as Warning / Info records tagged
+ * "loggable". Called by the drain task between batches.
+ */
+void governor_poll() noexcept;
+
+/**
+ * @brief Register the failed allocation callback, if configured.
+ */
+void governor_start() noexcept;
+
+} // namespace detail
+} // namespace espidf
+} // namespace loggable
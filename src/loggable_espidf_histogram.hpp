@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace loggable {
+namespace espidf {
+namespace detail {
+
+/**
+ * @brief Log-linear histogram of 32-bit values, HDR style.
+ *
+ * Values below 8 get a bucket each; above that every power of two is split
+ * into 8 linear sub-buckets, so any recorded value is known to within
+ * 12.5% over the full 32-bit range in under 1 KiB. Percentiles report the
+ * highest value of the bucket they land in, erring high.
+ *
+ * Not thread safe; callers keep one per producer and merge, or serialize.
+ */
+class LatencyHistogram {
+public:
+    static constexpr size_t kSubBuckets = 8;
+    static constexpr size_t kBuckets = kSubBuckets + (32 - 3) * kSubBuckets;
+
+    void record(uint32_t value) noexcept {
+        ++_counts[index(value)];
+        ++_total;
+        if (value > _max) {
+            _max = value;
+        }
+    }
+
+    void merge(const LatencyHistogram& other) noexcept {
+        for (size_t i = 0; i < kBuckets; ++i) {
+            _counts[i] += other._counts[i];
+        }
+        _total += other._total;
+        if (other._max > _max) {
+            _max = other._max;
+        }
+    }
+
+    /**
+     * @brief Value below which `per_mille` thousandths of the samples fall.
+     * @return 0 if nothing was recorded.
+     */
+    uint32_t percentile(uint32_t per_mille) const noexcept {
+        if (_total == 0) {
+            return 0;
+        }
+        const uint64_t rank = (_total * per_mille + 999) / 1000;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBuckets; ++i) {
+            seen += _counts[i];
+            if (seen >= rank && _counts[i] != 0) {
+                const uint32_t high = highest(i);
+                return high < _max ? high : _max;
+            }
+        }
+        return _max;
+    }
+
+    uint64_t count() const noexcept { return _total; }
+    uint32_t max() const noexcept { return _max; }
+
+    void clear() noexcept {
+        std::memset(_counts, 0, sizeof(_counts));
+        _total = 0;
+        _max = 0;
+    }
+
+private:
+    static size_t index(uint32_t value) noexcept {
+        if (value < kSubBuckets) {
+            return value;
+        }
+        const unsigned exponent = 31 - __builtin_clz(value);
+        const size_t sub = (value >> (exponent - 3)) & (kSubBuckets - 1);
+        return kSubBuckets + (exponent - 3) * kSubBuckets + sub;
+    }
+
+    static uint32_t highest(size_t index) noexcept {
+        if (index < kSubBuckets) {
+            return static_cast<uint32_t>(index);
+        }
+        const unsigned exponent = static_cast<unsigned>((index - kSubBuckets) / kSubBuckets) + 3;
+        const uint64_t sub = (index - kSubBuckets) % kSubBuckets;
+        const uint64_t high = ((kSubBuckets + sub + 1) << (exponent - 3)) - 1;
+        return high > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(high);
+    }
+
+    uint32_t _counts[kBuckets] = {};
+    uint64_t _total = 0;
+    uint32_t _max = 0;
+};
+
+} // namespace detail
+} // namespace espidf
+} // namespace loggable
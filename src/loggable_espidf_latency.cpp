@@ -0,0 +1,104 @@
+#include "loggable_espidf_latency.hpp"
+#include "loggable.hpp"
+#include "loggable_espidf_capture.hpp"
+#include "loggable_espidf_histogram.hpp"
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <mutex>
+#include <string>
+
+namespace loggable {
+namespace espidf {
+
+#if CONFIG_LOGGABLE_ESPIDF_LATENCY_TRACE
+
+namespace detail {
+
+namespace {
+
+static portMUX_TYPE latency_lock = portMUX_INITIALIZER_UNLOCKED;
+static LatencyHistogram histograms[kLatencyStages];
+static uint32_t window_start_ms = 0;
+// Copies of the histograms, taken under latency_lock so that percentiles
+// are computed outside it. Static: five of them would not fit on the stack
+// of every caller.
+static std::mutex snapshot_mutex;
+static LatencyHistogram snapshots[kLatencyStages];
+
+constexpr const char* kStageNames[kLatencyStages] = {"capture", "queue", "record_sinks", "sinker", "end_to_end"};
+
+} // namespace
+
+void record_latency(const LatencyStamps& stamps, uint32_t start, uint32_t sinks_done, uint32_t sinker_done) noexcept {
+    portENTER_CRITICAL(&latency_lock);
+    histograms[static_cast<size_t>(LatencyStage::Capture)].record(stamps.commit_us - stamps.entry_us);
+    histograms[static_cast<size_t>(LatencyStage::Queue)].record(start - stamps.commit_us);
+    histograms[static_cast<size_t>(LatencyStage::RecordSinks)].record(sinks_done - start);
+    histograms[static_cast<size_t>(LatencyStage::Sinker)].record(sinker_done - sinks_done);
+    histograms[static_cast<size_t>(LatencyStage::EndToEnd)].record(sinker_done - stamps.entry_us);
+    portEXIT_CRITICAL(&latency_lock);
+}
+
+} // namespace detail
+
+LatencyReport LogHook::latency_report(bool reset) noexcept {
+    LatencyReport report{};
+    const uint32_t now = esp_log_timestamp();
+
+    std::lock_guard<std::mutex> lock(detail::snapshot_mutex);
+    portENTER_CRITICAL(&detail::latency_lock);
+    report.window_ms = now - detail::window_start_ms;
+    for (size_t i = 0; i < kLatencyStages; ++i) {
+        detail::snapshots[i] = detail::histograms[i];
+        if (reset) {
+            detail::histograms[i].clear();
+        }
+    }
+    if (reset) {
+        detail::window_start_ms = now;
+    }
+    portEXIT_CRITICAL(&detail::latency_lock);
+
+    for (size_t i = 0; i < kLatencyStages; ++i) {
+        const detail::LatencyHistogram& histogram = detail::snapshots[i];
+        report.stages[i] = LatencyStats{histogram.count(),         histogram.percentile(500), histogram.percentile(900),
+                                        histogram.percentile(990), histogram.percentile(999), histogram.max()};
+    }
+    return report;
+}
+
+void LogHook::dump_latency_report(bool reset) noexcept {
+    const LatencyReport report = latency_report(reset);
+
+    char item[128];
+    std::snprintf(item, sizeof(item), "latency %" PRIu32 "ms (us count/p50/p90/p99/p99.9/max):", report.window_ms);
+    std::string payload = item;
+    for (size_t i = 0; i < kLatencyStages; ++i) {
+        const LatencyStats& stage = report.stages[i];
+        std::snprintf(item, sizeof(item), " %s=%" PRIu64 "/%" PRIu32 "/%" PRIu32 "/%" PRIu32 "/%" PRIu32 "/%" PRIu32 ";",
+                      detail::kStageNames[i], stage.count, stage.p50, stage.p90, stage.p99, stage.p999, stage.max);
+        payload += item;
+    }
+
+    detail::RcuReadGuard in_flight(detail::hook_rcu);
+    if (is_installed()) {
+        Sinker::instance().dispatch(LogMessage{std::chrono::system_clock::time_point(std::chrono::milliseconds(esp_log_timestamp())),
+                                               LogLevel::Info, "loggable", std::move(payload)});
+    }
+}
+
+#else
+
+LatencyReport LogHook::latency_report(bool) noexcept {
+    return LatencyReport{};
+}
+
+void LogHook::dump_latency_report(bool) noexcept {}
+
+#endif // CONFIG_LOGGABLE_ESPIDF_LATENCY_TRACE
+
+} // namespace espidf
+} // namespace loggable
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "loggable_espidf.hpp"
+#include <esp_timer.h>
+#include <cstdint>
+
+#ifndef CONFIG_LOGGABLE_ESPIDF_LATENCY_TRACE
+#define CONFIG_LOGGABLE_ESPIDF_LATENCY_TRACE 0
+#endif
+
+namespace loggable {
+namespace espidf {
+namespace detail {
+
+/**
+ * @brief Timestamps a line carries from the hook to the sinks.
+ *
+ * In microseconds of the system timer: the cycle counters of the two cores
+ * are not synchronized and a line usually changes core on its way to the
+ * drain task. Empty, and laid out as nothing, without
+ * CONFIG_LOGGABLE_ESPIDF_LATENCY_TRACE. Zero means not stamped.
+ */
+struct LatencyStamps {
+#if CONFIG_LOGGABLE_ESPIDF_LATENCY_TRACE
+    uint32_t entry_us = 0;
+    uint32_t commit_us = 0;
+#endif
+};
+
+#if CONFIG_LOGGABLE_ESPIDF_LATENCY_TRACE
+inline uint32_t latency_now() noexcept {
+    const uint32_t now = static_cast<uint32_t>(esp_timer_get_time());
+    return now ? now : 1;
+}
+
+/**
+ * @brief Charge the stages of one delivered line.
+ * @param start When delivery began.
+ * @param sinks_done When the record sinks returned.
+ * @param sinker_done When the Sinker returned.
+ */
+void record_latency(const LatencyStamps& stamps, uint32_t start, uint32_t sinks_done, uint32_t sinker_done) noexcept;
+#endif
+
+/// Stamps of a line entering the hook now.
+inline LatencyStamps stamp_entry() noexcept {
+#if CONFIG_LOGGABLE_ESPIDF_LATENCY_TRACE
+    return LatencyStamps{latency_now(), 0};
+#else
+    return {};
+#endif
+}
+
+/// Mark a stamped line as committed now.
+inline void stamp_commit([[maybe_unused]] LatencyStamps& stamps) noexcept {
+#if CONFIG_LOGGABLE_ESPIDF_LATENCY_TRACE
+    if (stamps.entry_us != 0) {
+        stamps.commit_us = latency_now();
+    }
+#endif
+}
+
+} // namespace detail
+} // namespace espidf
+} // namespace loggable
@@ -0,0 +1,337 @@
+#include "loggable_espidf_loadgen.hpp"
+#include "loggable_espidf_capture.hpp"
+#include "loggable_espidf_histogram.hpp"
+#include "loggable_espidf_stats.hpp"
+#include "loggable_os.hpp"
+#include <esp_idf_version.h>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <new>
+
+#ifndef CONFIG_LOGGABLE_ESPIDF_LOAD_GENERATOR
+#define CONFIG_LOGGABLE_ESPIDF_LOAD_GENERATOR 0
+#endif
+
+namespace loggable {
+
+namespace os {
+IAsyncBackend& get_freertos_backend() noexcept;
+} // namespace os
+
+namespace espidf {
+
+#if CONFIG_LOGGABLE_ESPIDF_LOAD_GENERATOR
+
+namespace {
+
+constexpr esp_log_level_t kLevels[5] = {ESP_LOG_ERROR, ESP_LOG_WARN, ESP_LOG_INFO, ESP_LOG_DEBUG, ESP_LOG_VERBOSE};
+// One literal per level, as ESP_LOGx expands to, so the hook reads the level
+// and tag from the format the way it does for real traffic.
+constexpr const char* kLineFormats[5] = {
+    "E (%" PRIu32 ") %s: %.*s\n", "W (%" PRIu32 ") %s: %.*s\n", "I (%" PRIu32 ") %s: %.*s\n",
+    "D (%" PRIu32 ") %s: %.*s\n", "V (%" PRIu32 ") %s: %.*s\n",
+};
+/// The first write of a split line: kLineFormats without the newline.
+constexpr const char* kHeadFormats[5] = {
+    "E (%" PRIu32 ") %s: %.*s", "W (%" PRIu32 ") %s: %.*s", "I (%" PRIu32 ") %s: %.*s",
+    "D (%" PRIu32 ") %s: %.*s", "V (%" PRIu32 ") %s: %.*s",
+};
+
+/// Throughput gain below which adding producers counts as saturated, in percent.
+constexpr uint32_t kSaturationGainPercent = 5;
+
+/// Body text; lines print a prefix of it.
+struct Filler {
+    char text[kMaxLoadLineLength];
+    constexpr Filler() : text{} {
+        for (size_t i = 0; i < kMaxLoadLineLength; ++i) {
+            text[i] = static_cast<char>('a' + i % 26);
+        }
+    }
+};
+constexpr Filler kFiller{};
+
+struct Xorshift32 {
+    uint32_t state;
+
+    uint32_t next() noexcept {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    /// Uniform enough in [0, bound) for load shaping.
+    uint32_t below(uint32_t bound) noexcept { return bound ? next() % bound : 0; }
+};
+
+struct Worker {
+    const LoadProfile* profile;
+    uint32_t level_total;
+    uint32_t start_ms;
+    uint32_t end_ms;
+    uint32_t lines;
+    Xorshift32 random;
+    std::atomic<size_t>* finished;
+    os::SemaphoreHandle done;
+    char tags[kMaxLoadTags][8];
+    char name[16];
+    detail::LatencyHistogram latency;
+};
+
+size_t pick_level(Worker& worker) noexcept {
+    uint32_t roll = worker.random.below(worker.level_total);
+    for (size_t i = 0; i < 5; ++i) {
+        if (roll < worker.profile->level_weights[i]) {
+            return i;
+        }
+        roll -= worker.profile->level_weights[i];
+    }
+    return 2;
+}
+
+/// Emit one line the way ESP_LOGx does and record how long the call took.
+void emit_line(Worker& worker) noexcept {
+    const LoadProfile& profile = *worker.profile;
+    const size_t level = pick_level(worker);
+    const char* tag = worker.tags[worker.random.below(static_cast<uint32_t>(profile.tag_count))];
+    const uint32_t spread = static_cast<uint32_t>(profile.max_line_length - profile.min_line_length + 1);
+    const int length = static_cast<int>(profile.min_line_length + worker.random.below(spread));
+    const bool partial = worker.random.below(100) < profile.partial_percent && length > 1;
+
+    const uint32_t start = detail::cycle_count();
+    if (partial) {
+        const int head = length / 2;
+        esp_log_write(kLevels[level], tag, kHeadFormats[level], esp_log_timestamp(), tag, head, kFiller.text);
+        esp_log_write(kLevels[level], tag, "%.*s\n", length - head, kFiller.text + head);
+    } else {
+        esp_log_write(kLevels[level], tag, kLineFormats[level], esp_log_timestamp(), tag, length, kFiller.text);
+    }
+    worker.latency.record(detail::cycle_count() - start);
+    worker.lines += 1;
+}
+
+void worker_main(void* arg) {
+    auto& worker = *static_cast<Worker*>(arg);
+    const LoadProfile& profile = *worker.profile;
+    auto& backend = os::get_freertos_backend();
+
+    worker.start_ms = backend.get_time_ms();
+    uint32_t since_yield = 0;
+    for (;;) {
+        const uint32_t elapsed = backend.get_time_ms() - worker.start_ms;
+        if (elapsed >= profile.duration_ms) {
+            break;
+        }
+        if (profile.lines_per_second != 0 &&
+            worker.lines >= static_cast<uint64_t>(elapsed) * profile.lines_per_second / 1000) {
+            backend.delay_ms(1);
+            continue;
+        }
+
+        const uint32_t count = worker.random.below(100) < profile.burst_percent ? profile.burst_lines : 1;
+        for (uint32_t i = 0; i < count; ++i) {
+            emit_line(worker);
+        }
+
+        since_yield += count;
+        if (profile.lines_per_second == 0 && since_yield >= profile.yield_lines) {
+            since_yield = 0;
+            backend.delay_ms(1);
+        }
+    }
+    worker.end_ms = backend.get_time_ms();
+
+    worker.finished->fetch_add(1, std::memory_order_release);
+    backend.semaphore_give(worker.done);
+    backend.task_delete(os::TaskHandle{nullptr});
+}
+
+bool valid(const LoadProfile& profile) noexcept {
+    uint32_t level_total = 0;
+    for (const uint8_t weight : profile.level_weights) {
+        level_total += weight;
+    }
+    return profile.tasks != 0 && profile.tasks <= kMaxLoadTasks && profile.tag_count != 0 &&
+           profile.tag_count <= kMaxLoadTags && profile.min_line_length <= profile.max_line_length &&
+           profile.max_line_length <= kMaxLoadLineLength && level_total != 0 && profile.yield_lines != 0;
+}
+
+/// Let the drain task catch up on earlier output, within the quiesce timeout.
+void wait_for_drain(os::IAsyncBackend& backend) noexcept {
+    const uint32_t start = backend.get_time_ms();
+    while (detail::capture_running() && detail::capture_pending() != 0 &&
+           backend.get_time_ms() - start < CONFIG_LOGGABLE_ESPIDF_QUIESCE_TIMEOUT_MS) {
+        backend.delay_ms(10);
+    }
+}
+
+} // namespace
+
+bool LoadGenerator::run(const LoadProfile& profile, LoadResult& result) noexcept {
+    result = LoadResult{};
+    if (!valid(profile)) {
+        return false;
+    }
+    auto* workers = new (std::nothrow) Worker[profile.tasks];
+    if (!workers) {
+        return false;
+    }
+
+    auto& backend = os::get_freertos_backend();
+    std::atomic<size_t> finished{0};
+    os::SemaphoreHandle done = backend.semaphore_create_binary();
+    if (!done) {
+        delete[] workers;
+        return false;
+    }
+
+    wait_for_drain(backend);
+    const uint32_t dropped_before = detail::capture_dropped_total();
+    const AllocationReport allocations_before = LogHook::allocation_report();
+    detail::capture_high_water(true);
+    const detail::CaptureContention contention_before = detail::capture_contention();
+
+    size_t started = 0;
+    for (size_t i = 0; i < profile.tasks; ++i) {
+        Worker& worker = workers[i];
+        worker.profile = &profile;
+        worker.level_total = 0;
+        for (const uint8_t weight : profile.level_weights) {
+            worker.level_total += weight;
+        }
+        worker.lines = 0;
+        // Zero would make xorshift emit zeros forever.
+        worker.random.state = profile.seed * 2654435761u + static_cast<uint32_t>(i) + 1;
+        if (worker.random.state == 0) {
+            worker.random.state = 1;
+        }
+        worker.finished = &finished;
+        worker.done = done;
+        for (size_t t = 0; t < profile.tag_count; ++t) {
+            std::snprintf(worker.tags[t], sizeof(worker.tags[t]), "load%u", static_cast<unsigned>(t));
+        }
+        std::snprintf(worker.name, sizeof(worker.name), "loadgen%u", static_cast<unsigned>(i));
+
+        os::TaskConfig config;
+        config.name = worker.name;
+        config.stack_size = profile.stack_size;
+        config.priority = profile.priority;
+        config.core = profile.pinned ? static_cast<int>(i % portNUM_PROCESSORS) : -1;
+        if (!backend.task_create(config, &worker_main, &worker)) {
+            break;
+        }
+        ++started;
+    }
+
+    while (finished.load(std::memory_order_acquire) < started) {
+        backend.semaphore_take(done, 100);
+    }
+    wait_for_drain(backend);
+
+    detail::LatencyHistogram latency;
+    uint32_t first_start = UINT32_MAX;
+    uint32_t last_end = 0;
+    for (size_t i = 0; i < started; ++i) {
+        latency.merge(workers[i].latency);
+        result.lines += workers[i].lines;
+        first_start = workers[i].start_ms < first_start ? workers[i].start_ms : first_start;
+        last_end = workers[i].end_ms > last_end ? workers[i].end_ms : last_end;
+    }
+    backend.semaphore_destroy(done);
+    delete[] workers;
+
+    result.tasks = started;
+    result.duration_ms = started ? last_end - first_start : 0;
+    result.lines_per_second =
+        result.duration_ms ? static_cast<uint32_t>(static_cast<uint64_t>(result.lines) * 1000 / result.duration_ms) : 0;
+    result.dropped_lines = detail::capture_dropped_total() - dropped_before;
+    const AllocationReport allocations = LogHook::allocation_report();
+    result.allocations = (allocations.hook_allocations - allocations_before.hook_allocations) +
+                         (allocations.delivery_allocations - allocations_before.delivery_allocations);
+    result.peak_capture_bytes = static_cast<uint32_t>(detail::capture_high_water());
+    const detail::CaptureContention contention = detail::capture_contention();
+    result.lock_acquisitions = contention.acquisitions - contention_before.acquisitions;
+    result.lock_contentions = contention.contended - contention_before.contended;
+    result.latency_p50 = latency.percentile(500);
+    result.latency_p90 = latency.percentile(900);
+    result.latency_p99 = latency.percentile(990);
+    result.latency_p999 = latency.percentile(999);
+    result.latency_max = latency.max();
+    return started == profile.tasks;
+}
+
+size_t LoadGenerator::find_saturation(const LoadProfile& profile, size_t max_tasks, LoadResult* results,
+                                      size_t max_results) noexcept {
+    LoadProfile step = profile;
+    size_t count = 0;
+    for (size_t tasks = 1; tasks <= max_tasks && tasks <= kMaxLoadTasks && count < max_results; tasks *= 2) {
+        step.tasks = tasks;
+        LoadResult& result = results[count];
+        const bool ok = run(step, result);
+        ++count;
+        if (!ok || result.dropped_lines != 0) {
+            break;
+        }
+        if (count > 1) {
+            const uint64_t previous = results[count - 2].lines_per_second;
+            if (result.lines_per_second * 100ull < previous * (100 + kSaturationGainPercent)) {
+                break;
+            }
+        }
+    }
+    return count;
+}
+
+#else
+
+bool LoadGenerator::run(const LoadProfile&, LoadResult& result) noexcept {
+    result = LoadResult{};
+    return false;
+}
+
+size_t LoadGenerator::find_saturation(const LoadProfile&, size_t, LoadResult*, size_t) noexcept {
+    return 0;
+}
+
+#endif // CONFIG_LOGGABLE_ESPIDF_LOAD_GENERATOR
+
+size_t LoadGenerator::to_json(const LoadProfile& profile, const LoadResult& result, char* out, size_t size) noexcept {
+#ifdef CONFIG_IDF_TARGET
+    const char* target = CONFIG_IDF_TARGET;
+#else
+    const char* target = "unknown";
+#endif
+#ifdef CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ
+    const unsigned cpu_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+#else
+    const unsigned cpu_mhz = 0;
+#endif
+    const int length = std::snprintf(
+        out, size,
+        "{\"env\":{\"idf\":\"%d.%d.%d\",\"target\":\"%s\",\"cores\":%d,\"cpu_mhz\":%u,\"capture_buffer\":%u},"
+        "\"profile\":{\"seed\":%" PRIu32 ",\"tasks\":%u,\"pinned\":%s,\"duration_ms\":%" PRIu32 ",\"lines_per_second\":%" PRIu32
+        ",\"tags\":%u,\"min_line_length\":%u,\"max_line_length\":%u,\"partial_percent\":%u,\"burst_percent\":%u},"
+        "\"metrics\":{\"tasks\":%u,\"duration_ms\":%" PRIu32 ",\"lines\":%" PRIu32 ",\"lines_per_second\":%" PRIu32
+        ",\"dropped_lines\":%" PRIu32 ",\"cycles_p50\":%" PRIu32 ",\"cycles_p90\":%" PRIu32 ",\"cycles_p99\":%" PRIu32
+        ",\"cycles_p999\":%" PRIu32 ",\"cycles_max\":%" PRIu32 ",\"allocations\":%" PRIu32
+        ",\"allocations_per_line\":%.3f,\"peak_capture_bytes\":%" PRIu32 ",\"lock_acquisitions\":%" PRIu32
+        ",\"lock_contentions\":%" PRIu32 "}}",
+        ESP_IDF_VERSION_MAJOR, ESP_IDF_VERSION_MINOR, ESP_IDF_VERSION_PATCH, target, portNUM_PROCESSORS, cpu_mhz,
+        static_cast<unsigned>(CONFIG_LOGGABLE_ESPIDF_CAPTURE_BUFFER_SIZE), profile.seed,
+        static_cast<unsigned>(profile.tasks), profile.pinned ? "true" : "false", profile.duration_ms, profile.lines_per_second,
+        static_cast<unsigned>(profile.tag_count), static_cast<unsigned>(profile.min_line_length),
+        static_cast<unsigned>(profile.max_line_length), profile.partial_percent, profile.burst_percent,
+        static_cast<unsigned>(result.tasks), result.duration_ms, result.lines, result.lines_per_second,
+        result.dropped_lines, result.latency_p50, result.latency_p90, result.latency_p99, result.latency_p999,
+        result.latency_max, result.allocations,
+        result.lines ? static_cast<double>(result.allocations) / result.lines : 0.0, result.peak_capture_bytes,
+        result.lock_acquisitions, result.lock_contentions);
+    return length < 0 ? 0 : static_cast<size_t>(length);
+}
+
+} // namespace espidf
+} // namespace loggable
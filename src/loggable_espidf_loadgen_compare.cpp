@@ -0,0 +1,148 @@
+#include "loggable_espidf_loadgen.hpp"
+#include <charconv>
+
+namespace loggable {
+namespace espidf {
+
+namespace {
+
+/// Whether `current` exceeds `baseline` by more than `percent`; lower is better.
+bool worse(uint64_t baseline, uint64_t current, uint8_t percent) noexcept {
+    return current * 100 > baseline * (100u + percent);
+}
+
+/// Like worse(), but a zero baseline means the metric was not recorded.
+bool worse_recorded(uint64_t baseline, uint64_t current, uint8_t percent) noexcept {
+    return baseline != 0 && worse(baseline, current, percent);
+}
+
+/**
+ * @brief The members of the object stored under `key`, without the braces.
+ *
+ * Enough JSON for to_json()'s output: the object must not hold nested
+ * objects, and keys are matched with their quotes and colon.
+ */
+std::string_view member_object(std::string_view json, std::string_view key) noexcept {
+    for (size_t at = json.find(key); at != std::string_view::npos; at = json.find(key, at + 1)) {
+        if (at == 0 || json[at - 1] != '"') {
+            continue;
+        }
+        size_t open = at + key.size();
+        if (json.substr(open, 3) != "\":{") {
+            continue;
+        }
+        open += 3;
+        const size_t close = json.find('}', open);
+        return close == std::string_view::npos ? std::string_view{} : json.substr(open, close - open);
+    }
+    return {};
+}
+
+/// The text of the scalar stored under `key` in the members of an object.
+std::string_view member_value(std::string_view object, std::string_view key) noexcept {
+    for (size_t at = object.find(key); at != std::string_view::npos; at = object.find(key, at + 1)) {
+        const size_t value = at + key.size() + 2;
+        if (at == 0 || object[at - 1] != '"' || object.substr(at + key.size(), 2) != "\":") {
+            continue;
+        }
+        size_t end = object.find(',', value);
+        end = end == std::string_view::npos ? object.size() : end;
+        return object.substr(value, end - value);
+    }
+    return {};
+}
+
+template <typename T>
+bool read_number(std::string_view object, std::string_view key, T& out) noexcept {
+    const std::string_view text = member_value(object, key);
+    uint64_t value;
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (text.empty() || error != std::errc() || end != text.data() + text.size() || value > T(~T(0))) {
+        return false;
+    }
+    out = static_cast<T>(value);
+    return true;
+}
+
+bool read_bool(std::string_view object, std::string_view key, bool& out) noexcept {
+    const std::string_view text = member_value(object, key);
+    if (text != "true" && text != "false") {
+        return false;
+    }
+    out = text == "true";
+    return true;
+}
+
+} // namespace
+
+bool LoadGenerator::from_json(std::string_view json, LoadProfile& profile, LoadResult& result) noexcept {
+    const std::string_view in = member_object(json, "profile");
+    const std::string_view out = member_object(json, "metrics");
+    if (in.empty() || out.empty()) {
+        return false;
+    }
+    LoadProfile parsed_profile;
+    LoadResult parsed{};
+    const bool ok = read_number(in, "seed", parsed_profile.seed) && read_number(in, "tasks", parsed_profile.tasks) &&
+                    read_bool(in, "pinned", parsed_profile.pinned) &&
+                    read_number(in, "duration_ms", parsed_profile.duration_ms) &&
+                    read_number(in, "lines_per_second", parsed_profile.lines_per_second) &&
+                    read_number(in, "tags", parsed_profile.tag_count) &&
+                    read_number(in, "min_line_length", parsed_profile.min_line_length) &&
+                    read_number(in, "max_line_length", parsed_profile.max_line_length) &&
+                    read_number(in, "partial_percent", parsed_profile.partial_percent) &&
+                    read_number(in, "burst_percent", parsed_profile.burst_percent) &&
+                    read_number(out, "tasks", parsed.tasks) && read_number(out, "duration_ms", parsed.duration_ms) &&
+                    read_number(out, "lines", parsed.lines) &&
+                    read_number(out, "lines_per_second", parsed.lines_per_second) &&
+                    read_number(out, "dropped_lines", parsed.dropped_lines) &&
+                    read_number(out, "cycles_p50", parsed.latency_p50) &&
+                    read_number(out, "cycles_p90", parsed.latency_p90) &&
+                    read_number(out, "cycles_p99", parsed.latency_p99) &&
+                    read_number(out, "cycles_p999", parsed.latency_p999) &&
+                    read_number(out, "cycles_max", parsed.latency_max) &&
+                    read_number(out, "allocations", parsed.allocations) &&
+                    read_number(out, "peak_capture_bytes", parsed.peak_capture_bytes) &&
+                    read_number(out, "lock_acquisitions", parsed.lock_acquisitions) &&
+                    read_number(out, "lock_contentions", parsed.lock_contentions);
+    if (!ok) {
+        return false;
+    }
+    profile = parsed_profile;
+    result = parsed;
+    return true;
+}
+
+uint32_t LoadGenerator::compare(const LoadResult& baseline, const LoadResult& current,
+                                const LoadThresholds& thresholds) noexcept {
+    uint32_t regressions = 0;
+    // Throughput is the one metric where higher is better: swap the roles.
+    if (baseline.lines_per_second != 0 &&
+        worse(current.lines_per_second, baseline.lines_per_second, thresholds.throughput_percent)) {
+        regressions |= kLoadThroughput;
+    }
+    if (worse_recorded(baseline.latency_p50, current.latency_p50, thresholds.latency_percent)) {
+        regressions |= kLoadLatencyP50;
+    }
+    if (worse_recorded(baseline.latency_p99, current.latency_p99, thresholds.latency_percent)) {
+        regressions |= kLoadLatencyP99;
+    }
+    // Per line, cross-multiplied so runs of different length compare. A
+    // baseline without allocations is a budget: any allocation regresses.
+    if (baseline.allocations == 0 ? current.allocations != 0
+                                  : worse(static_cast<uint64_t>(baseline.allocations) * current.lines,
+                                          static_cast<uint64_t>(current.allocations) * baseline.lines,
+                                          thresholds.allocations_percent)) {
+        regressions |= kLoadAllocations;
+    }
+    if (worse_recorded(baseline.peak_capture_bytes, current.peak_capture_bytes, thresholds.memory_percent)) {
+        regressions |= kLoadPeakMemory;
+    }
+    if (baseline.dropped_lines == 0 && current.dropped_lines != 0) {
+        regressions |= kLoadDrops;
+    }
+    return regressions;
+}
+
+} // namespace espidf
+} // namespace loggable
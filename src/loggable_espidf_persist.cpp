@@ -0,0 +1,150 @@
+#include "loggable_espidf.hpp"
+#include "loggable_espidf_task.hpp"
+#include <nvs.h>
+#include <cstddef>
+#include <cstring>
+
+#ifndef CONFIG_LOGGABLE_ESPIDF_NVS_NAMESPACE
+#define CONFIG_LOGGABLE_ESPIDF_NVS_NAMESPACE "loggable"
+#endif
+
+namespace loggable {
+namespace espidf {
+
+namespace {
+
+constexpr const char* kConfigKey = "config";
+constexpr uint32_t kConfigMagic = 0x46434c47;  // "GLCF"
+/// Bump whenever a field changes meaning without changing the layout.
+constexpr uint16_t kConfigVersion = 2;
+
+/// Bits of PersistedConfig::flags.
+constexpr uint8_t kCallOriginalVprintf = 1 << 0;
+constexpr uint8_t kAsyncCapture = 1 << 1;
+constexpr uint8_t kRouteToSinker = 1 << 2;
+constexpr uint8_t kRouteToRecordSinks = 1 << 3;
+
+/**
+ * @brief NVS image of the configuration.
+ *
+ * HookConfig is copied in field by field, so the image holds no padding or
+ * bool object representations and its checksum only covers bytes that were
+ * written. Fields are ordered by size to leave no gaps before the end of
+ * tag_levels. The size field rejects blobs from builds with a different
+ * layout, e.g. another LOGGABLE_ESPIDF_TAG_LEVEL_SLOTS.
+ */
+struct PersistedConfig {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;
+    uint32_t checksum;  ///< FNV-1a of the fields after this one.
+    uint32_t continuation_window_ms;
+    uint32_t partial_line_timeout_ms;
+    uint32_t tag_hashes[kTagLevelSlots];
+    uint16_t task_lines_per_second;
+    uint16_t tag_count;
+    uint8_t flags;
+    uint8_t max_level;
+    uint8_t default_task_level;
+    uint8_t tag_levels[kTagLevelSlots];
+};
+
+constexpr size_t kChecksumBegin = offsetof(PersistedConfig, continuation_window_ms);
+constexpr size_t kChecksumEnd = offsetof(PersistedConfig, tag_levels) + sizeof(PersistedConfig::tag_levels);
+
+static_assert(kChecksumEnd == 27 + 5 * kTagLevelSlots, "PersistedConfig has padding inside its checksummed fields");
+
+uint32_t checksum(const PersistedConfig& blob) {
+    const auto* bytes = reinterpret_cast<const char*>(&blob);
+    return detail::fnv1a(std::string_view(bytes + kChecksumBegin, kChecksumEnd - kChecksumBegin));
+}
+
+bool valid(const PersistedConfig& blob) {
+    if (blob.magic != kConfigMagic || blob.version != kConfigVersion || blob.size != sizeof(PersistedConfig) ||
+        blob.checksum != checksum(blob)) {
+        return false;
+    }
+    return blob.default_task_level <= ESP_LOG_VERBOSE && blob.max_level <= ESP_LOG_VERBOSE &&
+           blob.tag_count <= kTagLevelSlots;
+}
+
+void store(const HookConfig& config, PersistedConfig& blob) {
+    blob.continuation_window_ms = config.continuation_window_ms;
+    blob.partial_line_timeout_ms = config.partial_line_timeout_ms;
+    std::memcpy(blob.tag_hashes, config.tag_levels.hashes, sizeof(blob.tag_hashes));
+    blob.task_lines_per_second = config.task_lines_per_second;
+    blob.tag_count = config.tag_levels.count;
+    blob.flags = (config.call_original_vprintf ? kCallOriginalVprintf : 0) |
+                 (config.async_capture ? kAsyncCapture : 0) | (config.route_to_sinker ? kRouteToSinker : 0) |
+                 (config.route_to_record_sinks ? kRouteToRecordSinks : 0);
+    blob.max_level = static_cast<uint8_t>(config.max_level);
+    std::memcpy(blob.tag_levels, config.tag_levels.levels, sizeof(blob.tag_levels));
+}
+
+HookConfig restore(const PersistedConfig& blob) {
+    HookConfig config;
+    config.call_original_vprintf = (blob.flags & kCallOriginalVprintf) != 0;
+    config.async_capture = (blob.flags & kAsyncCapture) != 0;
+    config.route_to_sinker = (blob.flags & kRouteToSinker) != 0;
+    config.route_to_record_sinks = (blob.flags & kRouteToRecordSinks) != 0;
+    config.max_level = static_cast<esp_log_level_t>(blob.max_level);
+    config.task_lines_per_second = blob.task_lines_per_second;
+    config.continuation_window_ms = blob.continuation_window_ms;
+    config.partial_line_timeout_ms = blob.partial_line_timeout_ms;
+    std::memcpy(config.tag_levels.hashes, blob.tag_hashes, sizeof(blob.tag_hashes));
+    std::memcpy(config.tag_levels.levels, blob.tag_levels, sizeof(blob.tag_levels));
+    config.tag_levels.count = blob.tag_count;
+    return config;
+}
+
+} // namespace
+
+bool LogHook::save_config() noexcept {
+    PersistedConfig blob;
+    std::memset(static_cast<void*>(&blob), 0, sizeof(blob));
+    store(config(), blob);
+    blob.magic = kConfigMagic;
+    blob.version = kConfigVersion;
+    blob.size = sizeof(PersistedConfig);
+    blob.default_task_level = detail::default_task_level.load(std::memory_order_relaxed);
+    blob.checksum = checksum(blob);
+
+    nvs_handle_t handle;
+    if (nvs_open(CONFIG_LOGGABLE_ESPIDF_NVS_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+        return false;
+    }
+    const bool ok = nvs_set_blob(handle, kConfigKey, &blob, sizeof(blob)) == ESP_OK && nvs_commit(handle) == ESP_OK;
+    nvs_close(handle);
+    return ok;
+}
+
+bool LogHook::load_config() noexcept {
+    nvs_handle_t handle;
+    if (nvs_open(CONFIG_LOGGABLE_ESPIDF_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return false;
+    }
+    PersistedConfig blob;
+    size_t length = sizeof(blob);
+    const esp_err_t err = nvs_get_blob(handle, kConfigKey, &blob, &length);
+    nvs_close(handle);
+    if (err != ESP_OK || length != sizeof(blob) || !valid(blob)) {
+        return false;
+    }
+
+    set_default_task_level(static_cast<esp_log_level_t>(blob.default_task_level));
+    return configure(restore(blob));
+}
+
+bool LogHook::erase_saved_config() noexcept {
+    nvs_handle_t handle;
+    if (nvs_open(CONFIG_LOGGABLE_ESPIDF_NVS_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+        return false;
+    }
+    const esp_err_t err = nvs_erase_key(handle, kConfigKey);
+    const bool ok = (err == ESP_OK || err == ESP_ERR_NVS_NOT_FOUND) && nvs_commit(handle) == ESP_OK;
+    nvs_close(handle);
+    return ok;
+}
+
+} // namespace espidf
+} // namespace loggable
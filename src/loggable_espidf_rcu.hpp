@@ -0,0 +1,103 @@
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+namespace loggable {
+namespace espidf {
+namespace detail {
+
+/**
+ * @brief Read-copy-update domain with per-core reader counters.
+ *
+ * Readers bump a counter for the current grace-period parity on their core;
+ * no lock and no shared cache line between cores. Writers publish a new
+ * snapshot, then synchronize() flips the parity and waits until the readers
+ * of the previous one have left before the old snapshot is freed. The parity
+ * is flipped twice so a reader that sampled the parity just before a flip is
+ * always waited for.
+ *
+ * Read sections may be preempted and may migrate between cores; the token
+ * remembers which counter to release.
+ */
+class RcuDomain {
+public:
+    struct Token {
+        uint8_t parity;
+        uint8_t core;
+    };
+
+    Token read_lock() noexcept {
+        const Token token{static_cast<uint8_t>(_epoch.load() & 1), static_cast<uint8_t>(xPortGetCoreID())};
+        _cores[token.core].readers[token.parity].fetch_add(1);
+        return token;
+    }
+
+    void read_unlock(Token token) noexcept {
+        _cores[token.core].readers[token.parity].fetch_sub(1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Wait until every read section that may still see a replaced
+     *        snapshot has finished.
+     *
+     * Must not be called from inside a read section of the same domain.
+     *
+     * @param timeout_ms Give up after this long; by default wait forever.
+     * @return false on timeout, in which case old snapshots must be kept.
+     */
+    bool synchronize(uint32_t timeout_ms = UINT32_MAX) noexcept {
+        std::lock_guard<std::mutex> lock(_writer_mutex);
+        const TickType_t start = xTaskGetTickCount();
+        for (int round = 0; round < 2; ++round) {
+            const uint32_t parity = _epoch.fetch_add(1) & 1;
+            while (readers(parity) != 0) {
+                if (timeout_ms != UINT32_MAX && (xTaskGetTickCount() - start) * portTICK_PERIOD_MS >= timeout_ms) {
+                    return false;
+                }
+                vTaskDelay(1);
+            }
+        }
+        return true;
+    }
+
+private:
+    uint32_t readers(uint32_t parity) const noexcept {
+        uint32_t total = 0;
+        for (const auto& core : _cores) {
+            total += core.readers[parity].load();
+        }
+        return total;
+    }
+
+    struct alignas(64) CoreReaders {
+        std::atomic<uint32_t> readers[2] = {};
+    };
+
+    std::atomic<uint32_t> _epoch{0};
+    CoreReaders _cores[portNUM_PROCESSORS];
+    std::mutex _writer_mutex;
+};
+
+/**
+ * @brief Scoped read section of an RcuDomain.
+ */
+class RcuReadGuard {
+public:
+    explicit RcuReadGuard(RcuDomain& domain) noexcept : _domain(domain), _token(domain.read_lock()) {}
+    ~RcuReadGuard() { _domain.read_unlock(_token); }
+
+    RcuReadGuard(const RcuReadGuard&) = delete;
+    RcuReadGuard& operator=(const RcuReadGuard&) = delete;
+
+private:
+    RcuDomain& _domain;
+    RcuDomain::Token _token;
+};
+
+} // namespace detail
+} // namespace espidf
+} // namespace loggable
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "loggable_espidf.hpp"
+#include <atomic>
+#include <cstdint>
+#include <string_view>
+
+#ifndef CONFIG_LOGGABLE_ESPIDF_TRAFFIC_RECORDER
+#define CONFIG_LOGGABLE_ESPIDF_TRAFFIC_RECORDER 0
+#endif
+
+namespace loggable {
+namespace espidf {
+namespace detail {
+
+/// Set while TrafficRecorder is recording. Defined in loggable_espidf_traffic.cpp.
+extern std::atomic<bool> traffic_recording;
+
+/**
+ * @brief Append one invocation to the trace. Called from the hook only,
+ *        inside a hook_rcu read section.
+ */
+void append_traffic(const char* format, std::string_view output, uint16_t task_id) noexcept;
+
+/**
+ * @brief Record an invocation if a recording is running; one load otherwise.
+ *
+ * Acquire pairs with the release in TrafficRecorder::start(), so a hook that
+ * sees the flag also sees the buffer, capacity and write offset it set up.
+ */
+inline void record_traffic(const char* format, std::string_view output, uint16_t task_id) noexcept {
+    if (traffic_recording.load(std::memory_order_acquire)) [[unlikely]] {
+        append_traffic(format, output, task_id);
+    }
+}
+
+} // namespace detail
+} // namespace espidf
+} // namespace loggable
@@ -0,0 +1,165 @@
+#include "loggable_espidf_report.hpp"
+#include "loggable_espidf_capture.hpp"
+#include "loggable_espidf_histogram.hpp"
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <chrono>
+#include <mutex>
+#include <type_traits>
+
+namespace loggable {
+namespace espidf {
+
+static_assert(std::is_trivially_copyable_v<SelfReport>, "SelfReport is delivered as raw bytes");
+
+#if CONFIG_LOGGABLE_ESPIDF_SELF_REPORT
+
+namespace detail {
+
+ReportCounters report_counters;
+
+namespace {
+
+static portMUX_TYPE cycles_lock = portMUX_INITIALIZER_UNLOCKED;
+static LatencyHistogram line_cycles;
+
+// Window state; serializes self_report() and the timer.
+static std::mutex report_mutex;
+// Copy of line_cycles taken under cycles_lock, so percentiles are computed
+// outside it; too large for the esp_timer task's stack.
+static LatencyHistogram cycles_snapshot;
+static int64_t window_start_us = 0;
+static uint32_t window_dropped = 0;
+static esp_timer_handle_t report_timer = nullptr;
+
+uint32_t per_second(uint32_t count, uint32_t window_ms) {
+    return window_ms ? static_cast<uint32_t>(static_cast<uint64_t>(count) * 1000 / window_ms) : 0;
+}
+
+void report_timer_cb(void*) {
+    const SelfReport report = LogHook::self_report(true);
+    const auto bytes = std::string_view(reinterpret_cast<const char*>(&report), sizeof(report));
+
+    RcuReadGuard in_flight(hook_rcu);
+    if (!LogHook::is_installed()) {
+        return;
+    }
+    const BlobInfo info{ESP_LOG_INFO, BlobFormat::Hex, 0, "loggable_perf"};
+    const LineOrigin origin{0, static_cast<uint8_t>(xPortGetCoreID()), std::chrono::system_clock::now()};
+    if (!capture_blob(info, bytes, origin)) {
+        deliver_blob(info, bytes, origin);
+    }
+}
+
+} // namespace
+
+void record_line_cycles(uint32_t cycles) noexcept {
+    portENTER_CRITICAL(&cycles_lock);
+    line_cycles.record(cycles);
+    portEXIT_CRITICAL(&cycles_lock);
+}
+
+} // namespace detail
+
+SelfReport LogHook::self_report(bool reset) noexcept {
+    std::lock_guard<std::mutex> lock(detail::report_mutex);
+    const int64_t now = esp_timer_get_time();
+    const uint32_t window_ms = static_cast<uint32_t>((now - detail::window_start_us) / 1000);
+    auto& counters = detail::report_counters;
+
+    SelfReport report{};
+    report.magic = kSelfReportMagic;
+    report.version = kSelfReportVersion;
+    report.size = sizeof(report);
+    report.window_ms = window_ms;
+
+    portENTER_CRITICAL(&detail::cycles_lock);
+    detail::cycles_snapshot = detail::line_cycles;
+    if (reset) {
+        detail::line_cycles.clear();
+    }
+    portEXIT_CRITICAL(&detail::cycles_lock);
+    report.hook_lines = static_cast<uint32_t>(detail::cycles_snapshot.count());
+    report.hook_cycles_p50 = detail::cycles_snapshot.percentile(500);
+    report.hook_cycles_p99 = detail::cycles_snapshot.percentile(990);
+
+    const uint32_t busy_us = reset ? counters.drain_busy_us.exchange(0, std::memory_order_relaxed)
+                                   : counters.drain_busy_us.load(std::memory_order_relaxed);
+    const uint64_t busy_permille = window_ms ? static_cast<uint64_t>(busy_us) / window_ms : 0;
+    report.drain_busy_permille = static_cast<uint16_t>(busy_permille < 1000 ? busy_permille : 1000);
+
+    report.capture_capacity = static_cast<uint32_t>(detail::capture_capacity());
+    report.capture_high_water = static_cast<uint32_t>(detail::capture_high_water(reset));
+    report.batch_high_water = reset ? counters.batch_high_water.exchange(0, std::memory_order_relaxed)
+                                    : counters.batch_high_water.load(std::memory_order_relaxed);
+    const uint32_t dropped = detail::capture_dropped_total();
+    report.dropped_lines = dropped - detail::window_dropped;
+
+    const LatencyReport latency = latency_report();
+    report.sinker_p99_us = latency.stages[static_cast<size_t>(LatencyStage::Sinker)].p99;
+    report.record_sinks_p99_us = latency.stages[static_cast<size_t>(LatencyStage::RecordSinks)].p99;
+    report.end_to_end_p99_us = latency.stages[static_cast<size_t>(LatencyStage::EndToEnd)].p99;
+
+    const uint32_t sinker_bytes = reset ? counters.sinker_bytes.exchange(0, std::memory_order_relaxed)
+                                        : counters.sinker_bytes.load(std::memory_order_relaxed);
+    const uint32_t record_sink_bytes = reset ? counters.record_sink_bytes.exchange(0, std::memory_order_relaxed)
+                                             : counters.record_sink_bytes.load(std::memory_order_relaxed);
+    report.sinker_bytes_per_second = detail::per_second(sinker_bytes, window_ms);
+    report.record_sinks_bytes_per_second = detail::per_second(record_sink_bytes, window_ms);
+
+    if (reset) {
+        detail::window_start_us = now;
+        detail::window_dropped = dropped;
+    }
+    return report;
+}
+
+bool LogHook::start_self_reports(uint32_t interval_ms) noexcept {
+    {
+        std::lock_guard<std::mutex> lock(detail::report_mutex);
+        if (!detail::report_timer) {
+            const esp_timer_create_args_t args = {
+                .callback = &detail::report_timer_cb,
+                .arg = nullptr,
+                .dispatch_method = ESP_TIMER_TASK,
+                .name = "loggable_perf",
+                .skip_unhandled_events = true,
+            };
+            if (esp_timer_create(&args, &detail::report_timer) != ESP_OK) {
+                detail::report_timer = nullptr;
+                return false;
+            }
+        } else {
+            esp_timer_stop(detail::report_timer);
+        }
+    }
+    (void)self_report(true);
+    return esp_timer_start_periodic(detail::report_timer, static_cast<uint64_t>(interval_ms) * 1000) == ESP_OK;
+}
+
+void LogHook::stop_self_reports() noexcept {
+    std::lock_guard<std::mutex> lock(detail::report_mutex);
+    if (detail::report_timer) {
+        esp_timer_stop(detail::report_timer);
+        esp_timer_delete(detail::report_timer);
+        detail::report_timer = nullptr;
+    }
+}
+
+#else
+
+SelfReport LogHook::self_report(bool) noexcept {
+    return SelfReport{};
+}
+
+bool LogHook::start_self_reports(uint32_t) noexcept {
+    return false;
+}
+
+void LogHook::stop_self_reports() noexcept {}
+
+#endif // CONFIG_LOGGABLE_ESPIDF_SELF_REPORT
+
+} // namespace espidf
+} // namespace loggable
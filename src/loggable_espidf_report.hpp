@@ -0,0 +1,68 @@
+#pragma once
+
+#include "loggable_espidf.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#ifndef CONFIG_LOGGABLE_ESPIDF_SELF_REPORT
+#define CONFIG_LOGGABLE_ESPIDF_SELF_REPORT 0
+#endif
+
+namespace loggable {
+namespace espidf {
+namespace detail {
+
+#if CONFIG_LOGGABLE_ESPIDF_SELF_REPORT
+/**
+ * @brief Counters of the current self-report window.
+ *
+ * Written by the drain task and by producers delivering synchronously,
+ * read and reset by the report. Defined in loggable_espidf_report.cpp.
+ */
+struct ReportCounters {
+    std::atomic<uint32_t> drain_busy_us{0};
+    std::atomic<uint32_t> batch_high_water{0};
+    std::atomic<uint32_t> sinker_bytes{0};
+    std::atomic<uint32_t> record_sink_bytes{0};
+};
+
+extern ReportCounters report_counters;
+
+/// Add the formatting cycles of one line to the window's histogram.
+void record_line_cycles(uint32_t cycles) noexcept;
+#endif
+
+/// Charge time the drain task spent delivering.
+inline void note_drain_busy([[maybe_unused]] uint32_t us) noexcept {
+#if CONFIG_LOGGABLE_ESPIDF_SELF_REPORT
+    report_counters.drain_busy_us.fetch_add(us, std::memory_order_relaxed);
+#endif
+}
+
+/// Track the drain batch arena's peak use. Drain task only.
+inline void note_batch_usage([[maybe_unused]] size_t bytes) noexcept {
+#if CONFIG_LOGGABLE_ESPIDF_SELF_REPORT
+    if (bytes > report_counters.batch_high_water.load(std::memory_order_relaxed)) {
+        report_counters.batch_high_water.store(static_cast<uint32_t>(bytes), std::memory_order_relaxed);
+    }
+#endif
+}
+
+/// Charge payload bytes handed to the record sinks.
+inline void note_record_sink_bytes([[maybe_unused]] size_t bytes) noexcept {
+#if CONFIG_LOGGABLE_ESPIDF_SELF_REPORT
+    report_counters.record_sink_bytes.fetch_add(static_cast<uint32_t>(bytes), std::memory_order_relaxed);
+#endif
+}
+
+/// Charge payload bytes handed to the Sinker.
+inline void note_sinker_bytes([[maybe_unused]] size_t bytes) noexcept {
+#if CONFIG_LOGGABLE_ESPIDF_SELF_REPORT
+    report_counters.sinker_bytes.fetch_add(static_cast<uint32_t>(bytes), std::memory_order_relaxed);
+#endif
+}
+
+} // namespace detail
+} // namespace espidf
+} // namespace loggable
@@ -0,0 +1,180 @@
+#include "loggable_espidf_stats.hpp"
+#include "loggable.hpp"
+#include "loggable_espidf_capture.hpp"
+#include "loggable_espidf_task.hpp"
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <chrono>
+#include <mutex>
+#include <type_traits>
+
+namespace loggable {
+namespace espidf {
+static_assert(std::is_trivially_copyable_v<VolumeReport>, "VolumeReport is delivered as raw bytes");
+
+namespace detail {
+
+namespace {
+
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static SpaceSaving<kVolumeSlots> task_table;
+static SpaceSaving<kVolumeSlots> tag_table;
+static uint32_t total_lines = 0;
+static uint64_t total_bytes = 0;
+static uint64_t total_cycles = 0;
+static uint32_t window_start_ms = 0;
+
+// Copies of the tables taken under stats_lock, so that the O(N^2) top-N
+// selection runs outside it. Guarded by snapshot_mutex.
+static std::mutex snapshot_mutex;
+static SpaceSaving<kVolumeSlots> task_snapshot;
+static SpaceSaving<kVolumeSlots> tag_snapshot;
+
+static std::mutex report_mutex;
+static esp_timer_handle_t report_timer = nullptr;
+static size_t report_top_n = kVolumeSlots;
+static VolumeReportCallback report_callback = nullptr;
+static void* report_user = nullptr;
+
+/// Deliver a report as a blob record, through the capture buffer when it runs.
+void dispatch_report(const VolumeReport& report) {
+    const auto bytes = std::string_view(reinterpret_cast<const char*>(&report), sizeof(report));
+    const BlobInfo info{ESP_LOG_INFO, BlobFormat::Hex, 0, "loggable_volume"};
+    const LineOrigin origin{0, static_cast<uint8_t>(xPortGetCoreID()), std::chrono::system_clock::now()};
+    if (!capture_blob(info, bytes, origin)) {
+        deliver_blob(info, bytes, origin);
+    }
+}
+
+/**
+ * @brief Build a report, or only reset the window if `out` is null.
+ *
+ * Takes snapshot_mutex; a reset without a report skips the copies.
+ */
+void take_report(VolumeReport* out, bool reset) {
+    const uint32_t now = esp_log_timestamp();
+    std::lock_guard<std::mutex> lock(snapshot_mutex);
+    portENTER_CRITICAL(&stats_lock);
+    if (out) {
+        out->window_ms = now - window_start_ms;
+        out->total_lines = total_lines;
+        out->total_bytes = total_bytes;
+        out->total_cycles = total_cycles;
+        task_snapshot = task_table;
+        tag_snapshot = tag_table;
+    }
+    if (reset) {
+        task_table.clear();
+        tag_table.clear();
+        total_lines = 0;
+        total_bytes = 0;
+        total_cycles = 0;
+        window_start_ms = now;
+    }
+    portEXIT_CRITICAL(&stats_lock);
+
+    if (out) {
+        out->task_count = task_snapshot.top(out->tasks, kVolumeSlots);
+        out->tag_count = tag_snapshot.top(out->tags, kVolumeSlots);
+    }
+}
+
+void report_timer_cb(void*) {
+    // Static: a VolumeReport is too large for the esp_timer task's stack.
+    // Timer callbacks run one at a time on that task.
+    static VolumeReport report;
+    report = VolumeReport{};
+    take_report(&report, true);
+    size_t top_n;
+    VolumeReportCallback callback;
+    void* user;
+    {
+        std::lock_guard<std::mutex> lock(report_mutex);
+        top_n = report_top_n;
+        callback = report_callback;
+        user = report_user;
+    }
+    for (size_t i = top_n; i < report.task_count; ++i) {
+        report.tasks[i] = VolumeEntry{};
+    }
+    for (size_t i = top_n; i < report.tag_count; ++i) {
+        report.tags[i] = VolumeEntry{};
+    }
+    report.task_count = report.task_count < top_n ? report.task_count : top_n;
+    report.tag_count = report.tag_count < top_n ? report.tag_count : top_n;
+
+    if (callback) {
+        callback(report, user);
+        return;
+    }
+    RcuReadGuard in_flight(hook_rcu);
+    if (LogHook::is_installed()) {
+        dispatch_report(report);
+    }
+}
+
+} // namespace
+
+void account_line(uint16_t task_id, std::string_view line, uint32_t bytes, uint32_t cycles) noexcept {
+    account_record(task_id, header_tag(line), bytes, cycles);
+}
+
+void account_record(uint16_t task_id, std::string_view tag, uint32_t bytes, uint32_t cycles) noexcept {
+    // Keyed by interned id rather than handle: FreeRTOS reuses the TCB of a
+    // deleted task, which would merge two tasks into one entry.
+    const char* name = task_name(task_id);
+
+    portENTER_CRITICAL(&stats_lock);
+    task_table.add(task_id, name, bytes, cycles);
+    tag_table.add(fnv1a(tag), tag, bytes, cycles);
+    total_lines += 1;
+    total_bytes += bytes;
+    total_cycles += cycles;
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+} // namespace detail
+
+VolumeReport LogHook::volume_report(bool reset) noexcept {
+    VolumeReport report{};
+    detail::take_report(&report, reset);
+    return report;
+}
+
+bool LogHook::start_volume_reports(uint32_t interval_ms, size_t top_n, VolumeReportCallback callback, void* user) noexcept {
+    std::lock_guard<std::mutex> lock(detail::report_mutex);
+    detail::report_top_n = top_n;
+    detail::report_callback = callback;
+    detail::report_user = user;
+
+    if (!detail::report_timer) {
+        const esp_timer_create_args_t args = {
+            .callback = &detail::report_timer_cb,
+            .arg = nullptr,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "loggable_volume",
+            .skip_unhandled_events = true,
+        };
+        if (esp_timer_create(&args, &detail::report_timer) != ESP_OK) {
+            detail::report_timer = nullptr;
+            return false;
+        }
+    } else {
+        esp_timer_stop(detail::report_timer);
+    }
+    detail::take_report(nullptr, true);
+    return esp_timer_start_periodic(detail::report_timer, static_cast<uint64_t>(interval_ms) * 1000) == ESP_OK;
+}
+
+void LogHook::stop_volume_reports() noexcept {
+    std::lock_guard<std::mutex> lock(detail::report_mutex);
+    if (detail::report_timer) {
+        esp_timer_stop(detail::report_timer);
+        esp_timer_delete(detail::report_timer);
+        detail::report_timer = nullptr;
+    }
+}
+
+} // namespace espidf
+} // namespace loggable
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "loggable_espidf.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#ifndef CONFIG_LOGGABLE_ESPIDF_VOLUME_STATS
+#define CONFIG_LOGGABLE_ESPIDF_VOLUME_STATS 0
+#endif
+
+#if __has_include(<esp_cpu.h>)
+#include <esp_cpu.h>
+#else
+#include <chrono>
+#endif
+
+namespace loggable {
+namespace espidf {
+namespace detail {
+
+/**
+ * @brief Read a free running cycle counter.
+ *
+ * Uses the CPU cycle counter on target and a nanosecond clock on hosts.
+ */
+inline uint32_t cycle_count() noexcept {
+#if __has_include(<esp_cpu.h>)
+    return static_cast<uint32_t>(esp_cpu_get_cycle_count());
+#else
+    return static_cast<uint32_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+/**
+ * @brief Extract the tag from an ESP-IDF line ("L (TIME) TAG: MESSAGE").
+ *
+ * The line must already be stripped of ANSI color sequences.
+ *
+ * @return The tag, or an empty view if the line has no ESP-IDF header.
+ */
+inline std::string_view header_tag(std::string_view line) noexcept {
+    if (line.size() < 5 || line[1] != ' ' || line[2] != '(') {
+        return {};
+    }
+    const size_t time_end = line.find(')', 3);
+    if (time_end == std::string_view::npos || time_end + 2 >= line.size() || line[time_end + 1] != ' ') {
+        return {};
+    }
+    const size_t colon = line.find(':', time_end + 2);
+    if (colon == std::string_view::npos) {
+        return {};
+    }
+    return line.substr(time_end + 2, colon - time_end - 2);
+}
+
+/**
+ * @brief Bounded heavy-hitter table using the Space-Saving algorithm.
+ *
+ * Keeps the `N` keys with the most lines. When a new key arrives and the
+ * table is full it evicts the entry with the fewest lines and inherits its
+ * counts, recording them as the error bound of the new entry. Any key with
+ * more than `total_lines / N` lines is guaranteed to be present.
+ *
+ * Not thread safe; callers serialize access.
+ */
+template <size_t N>
+class SpaceSaving {
+public:
+    /**
+     * @brief Charge one line to a key.
+     * @param key Identity of the producer.
+     * @param name Display name, copied only when the key enters the table.
+     */
+    void add(uintptr_t key, std::string_view name, uint32_t bytes, uint32_t cycles) noexcept {
+        VolumeEntry* slot = nullptr;
+        VolumeEntry* smallest = &_entries[0];
+        for (size_t i = 0; i < _size; ++i) {
+            if (_keys[i] == key) {
+                slot = &_entries[i];
+                break;
+            }
+            if (_entries[i].lines < smallest->lines) {
+                smallest = &_entries[i];
+            }
+        }
+
+        if (!slot) {
+            if (_size < N) {
+                slot = &_entries[_size];
+                _keys[_size++] = key;
+                *slot = VolumeEntry{};
+            } else {
+                slot = smallest;
+                _keys[slot - _entries] = key;
+                slot->error = slot->lines;
+            }
+            const size_t length = name.size() < sizeof(slot->name) - 1 ? name.size() : sizeof(slot->name) - 1;
+            std::memcpy(slot->name, name.data(), length);
+            slot->name[length] = '\0';
+        }
+
+        slot->lines += 1;
+        slot->bytes += bytes;
+        slot->cycles += cycles;
+    }
+
+    /**
+     * @brief Copy up to `max` entries, most lines first.
+     * @return Number of entries written.
+     */
+    size_t top(VolumeEntry* out, size_t max) const noexcept {
+        const size_t count = max < _size ? max : _size;
+        bool taken[N] = {};
+        for (size_t n = 0; n < count; ++n) {
+            size_t best = N;
+            for (size_t i = 0; i < _size; ++i) {
+                if (!taken[i] && (best == N || _entries[i].lines > _entries[best].lines)) {
+                    best = i;
+                }
+            }
+            taken[best] = true;
+            out[n] = _entries[best];
+        }
+        return count;
+    }
+
+    void clear() noexcept { _size = 0; }
+
+private:
+    uintptr_t _keys[N] = {};
+    VolumeEntry _entries[N] = {};
+    size_t _size = 0;
+};
+
+/**
+ * @brief Charge one record to its task and tag.
+ * @param task_id Interned id of the producer, see task_name().
+ */
+void account_record(uint16_t task_id, std::string_view tag, uint32_t bytes, uint32_t cycles) noexcept;
+
+/**
+ * @brief Charge one completed line to its task and tag.
+ * @param task_id Interned id of the producer, see task_name().
+ * @param line Complete line, stripped of ANSI color sequences.
+ * @param bytes Formatted size of the line.
+ * @param cycles Cycles spent formatting the line.
+ */
+void account_line(uint16_t task_id, std::string_view line, uint32_t bytes, uint32_t cycles) noexcept;
+
+} // namespace detail
+} // namespace espidf
+} // namespace loggable
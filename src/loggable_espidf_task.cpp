@@ -0,0 +1,292 @@
+#include "loggable_espidf_task.hpp"
+#include "loggable_espidf.hpp"
+#include "loggable_espidf_capture.hpp"
+#include "loggable_espidf_config.hpp"
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace loggable {
+namespace espidf {
+namespace detail {
+
+// Counts tasks with a level override, plus one while the default task level
+// is anything but ESP_LOG_VERBOSE. Zero means the hook can skip the per-task
+// level check entirely.
+std::atomic<int> task_level_filters{0};
+std::atomic<uint8_t> default_task_level{ESP_LOG_VERBOSE};
+std::atomic<uint32_t> held_records{0};
+
+namespace {
+
+static std::mutex context_mutex;
+static TaskContext* contexts = nullptr;
+static std::atomic<TaskContext*> orphans{nullptr};
+
+struct InternedName {
+    uint16_t task_id;
+    char name[configMAX_TASK_NAME_LEN];
+};
+
+static InternedName task_names[CONFIG_LOGGABLE_ESPIDF_TASK_NAMES];
+static uint16_t next_task_id = 1;
+
+/// Copy a task's name into the intern table. Called with context_mutex held.
+void intern_task(TaskContext& ctx, TaskHandle_t task) {
+    const uint16_t id = next_task_id++;
+    if (next_task_id == 0) {
+        next_task_id = 1;
+    }
+    const char* name = pcTaskGetName(task);
+    InternedName& entry = task_names[id % CONFIG_LOGGABLE_ESPIDF_TASK_NAMES];
+    std::strncpy(entry.name, name, sizeof(entry.name) - 1);
+    entry.name[sizeof(entry.name) - 1] = '\0';
+    entry.task_id = id;
+    ctx.task_id = id;
+    ctx.name = name;
+}
+
+/// A record taken out of a context, committed once the context mutex is released.
+struct FlushedLine {
+    std::string text;
+    LineOrigin origin;
+    uint32_t cycles;
+};
+
+/**
+ * @brief Take a partial line or held record out of a context as a complete record.
+ *
+ * Held records were charged to the rate limit when they completed; a line
+ * that never got its newline is charged here.
+ */
+void take_partial(TaskContext& ctx, uint16_t lines_per_second, std::vector<FlushedLine>& out) {
+    const uint32_t since = ctx.partial_since_ms.load(std::memory_order_relaxed);
+    if (ctx.log_buffer.empty()) {
+        return;
+    }
+    if (CONFIG_LOGGABLE_ESPIDF_HOOK_RATE_LIMIT && !ctx.record_held &&
+        !rate_allows(ctx, lines_per_second, esp_log_timestamp())) {
+        ctx.log_buffer.clear();
+    } else {
+        const LineOrigin origin{ctx.task_id, ctx.partial_core,
+                                std::chrono::system_clock::time_point(std::chrono::milliseconds(since)), ctx.stamps};
+        // Copied, so the task's buffer keeps its capacity for the next line.
+        out.push_back(FlushedLine{ctx.log_buffer, origin, ctx.format_cycles});
+        ctx.log_buffer.clear();
+    }
+    ctx.release_held();
+    ctx.format_cycles = 0;
+    ctx.partial_since_ms.store(0, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Unlink and free the contexts of deleted tasks.
+ *
+ * Called with context_mutex held; partial lines are appended to `out`.
+ */
+void reap_orphans(uint16_t lines_per_second, std::vector<FlushedLine>& out) {
+    TaskContext* ctx = orphans.exchange(nullptr, std::memory_order_acquire);
+    while (ctx) {
+        TaskContext* next_orphan = ctx->orphan;
+        (ctx->prev ? ctx->prev->next : contexts) = ctx->next;
+        if (ctx->next) {
+            ctx->next->prev = ctx->prev;
+        }
+        take_partial(*ctx, lines_per_second, out);
+        delete ctx;
+        ctx = next_orphan;
+    }
+}
+
+/**
+ * @brief TLS deletion callback.
+ *
+ * May run on the idle task, which must never block, so the context is only
+ * pushed onto a lock-free list; it is unlinked and freed by the next sweep or
+ * context creation.
+ */
+void delete_task_context(int, void* ptr) {
+    auto* ctx = static_cast<TaskContext*>(ptr);
+    if (ctx->level_override.load(std::memory_order_relaxed) != kNoLevelOverride) {
+        task_level_filters.fetch_sub(1, std::memory_order_relaxed);
+    }
+    ctx->orphan = orphans.load(std::memory_order_relaxed);
+    while (!orphans.compare_exchange_weak(ctx->orphan, ctx, std::memory_order_release, std::memory_order_relaxed)) {
+    }
+}
+
+void flush_partials(std::vector<FlushedLine>& partials) {
+    for (FlushedLine& line : partials) {
+        flush_line(line.text, line.origin, line.cycles);
+    }
+}
+
+uint16_t configured_rate_limit() {
+    ConfigGuard config;
+    return config->task_lines_per_second;
+}
+
+/// Create and register a task's context. Called with context_mutex held.
+TaskContext* create_task_context(TaskHandle_t task) noexcept {
+    if (TaskContext* ctx = find_task_context(task)) {
+        return ctx;
+    }
+    auto* ctx = new (std::nothrow) TaskContext();
+    if (!ctx) {
+        return nullptr;
+    }
+    intern_task(*ctx, task);
+    ctx->next = contexts;
+    if (contexts) {
+        contexts->prev = ctx;
+    }
+    contexts = ctx;
+#if configTHREAD_LOCAL_STORAGE_DELETE_CALLBACKS
+    vTaskSetThreadLocalStoragePointerAndDelCallback(task, CONFIG_LOGGABLE_ESPIDF_TLS_INDEX, ctx, &delete_task_context);
+#else
+    vTaskSetThreadLocalStoragePointer(task, CONFIG_LOGGABLE_ESPIDF_TLS_INDEX, ctx);
+#endif
+    return ctx;
+}
+
+bool apply_override(TaskHandle_t task, uint8_t level) noexcept {
+    TaskContext* ctx = get_task_context(task);
+    if (!ctx) {
+        return false;
+    }
+    const uint8_t previous = ctx->level_override.exchange(level, std::memory_order_relaxed);
+    if (previous == kNoLevelOverride && level != kNoLevelOverride) {
+        task_level_filters.fetch_add(1, std::memory_order_relaxed);
+    } else if (previous != kNoLevelOverride && level == kNoLevelOverride) {
+        task_level_filters.fetch_sub(1, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+} // namespace
+
+TaskContext* get_task_context(TaskHandle_t task) noexcept {
+    if (TaskContext* ctx = find_task_context(task)) {
+        return ctx;
+    }
+
+    // Contexts can be created for other tasks (level overrides by handle), so
+    // creation is serialized to keep two writers from racing on the slot.
+    std::vector<FlushedLine> partials;
+    const uint16_t lines_per_second = configured_rate_limit();
+    TaskContext* ctx;
+    {
+        std::lock_guard<std::mutex> lock(context_mutex);
+        reap_orphans(lines_per_second, partials);
+        ctx = create_task_context(task);
+    }
+    flush_partials(partials);
+    return ctx;
+}
+
+void sweep_task_contexts(bool flush_all) noexcept {
+    std::vector<FlushedLine> partials;
+    uint32_t continuation_window_ms;
+    uint32_t partial_line_timeout_ms;
+    uint16_t lines_per_second;
+    {
+        ConfigGuard config;
+        continuation_window_ms = config->continuation_window_ms;
+        partial_line_timeout_ms = config->partial_line_timeout_ms;
+        lines_per_second = config->task_lines_per_second;
+    }
+    {
+        std::lock_guard<std::mutex> lock(context_mutex);
+        reap_orphans(lines_per_second, partials);
+
+        const uint32_t now = esp_log_timestamp();
+        for (TaskContext* ctx = contexts; ctx; ctx = ctx->next) {
+            const uint32_t since = ctx->partial_since_ms.load(std::memory_order_relaxed);
+            const uint32_t timeout = ctx->record_held ? continuation_window_ms : partial_line_timeout_ms;
+            if (since == 0 || (!flush_all && now - since < timeout)) {
+                continue;
+            }
+            // A task appending right now is about to complete or refresh its
+            // line; it is looked at again on the next sweep.
+            if (ctx->try_acquire_buffer_for_sweep()) {
+                take_partial(*ctx, lines_per_second, partials);
+                ctx->release_buffer();
+            }
+        }
+    }
+    flush_partials(partials);
+}
+
+void trim_task_buffers() noexcept {
+    std::lock_guard<std::mutex> lock(context_mutex);
+    for (TaskContext* ctx = contexts; ctx; ctx = ctx->next) {
+        if (ctx->try_acquire_buffer_for_sweep()) {
+            if (ctx->log_buffer.empty()) {
+                std::string().swap(ctx->log_buffer);
+            }
+            ctx->release_buffer();
+        }
+    }
+}
+
+bool rate_allows(TaskContext& ctx, uint16_t lines_per_second, uint32_t now) noexcept {
+    if (lines_per_second == 0) [[likely]] {
+        return true;
+    }
+    if (now - ctx.rate_window_ms >= 1000) {
+        ctx.rate_window_ms = now;
+        ctx.rate_lines = 0;
+    }
+    if (ctx.rate_lines >= lines_per_second) {
+        count_rate_limited();
+        return false;
+    }
+    ++ctx.rate_lines;
+    return true;
+}
+
+const char* task_name(uint16_t task_id) noexcept {
+    const InternedName& entry = task_names[task_id % CONFIG_LOGGABLE_ESPIDF_TASK_NAMES];
+    return task_id != 0 && entry.task_id == task_id ? entry.name : "?";
+}
+
+bool task_level_enabled(esp_log_level_t level) noexcept {
+    return task_level_allows_level(level);
+}
+
+} // namespace detail
+
+bool LogHook::set_task_level(TaskHandle_t task, esp_log_level_t level) noexcept {
+    return detail::apply_override(task, static_cast<uint8_t>(level));
+}
+
+bool LogHook::set_task_level(const char* task_name, esp_log_level_t level) noexcept {
+    TaskHandle_t task = task_name ? xTaskGetHandle(task_name) : nullptr;
+    return task && set_task_level(task, level);
+}
+
+bool LogHook::clear_task_level(TaskHandle_t task) noexcept {
+    if (!detail::find_task_context(task)) {
+        return true;
+    }
+    return detail::apply_override(task, detail::kNoLevelOverride);
+}
+
+bool LogHook::clear_task_level(const char* task_name) noexcept {
+    TaskHandle_t task = task_name ? xTaskGetHandle(task_name) : nullptr;
+    return task && clear_task_level(task);
+}
+
+void LogHook::set_default_task_level(esp_log_level_t level) noexcept {
+    const uint8_t previous = detail::default_task_level.exchange(static_cast<uint8_t>(level), std::memory_order_relaxed);
+    if (previous == ESP_LOG_VERBOSE && level != ESP_LOG_VERBOSE) {
+        detail::task_level_filters.fetch_add(1, std::memory_order_relaxed);
+    } else if (previous != ESP_LOG_VERBOSE && level == ESP_LOG_VERBOSE) {
+        detail::task_level_filters.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+} // namespace espidf
+} // namespace loggable
@@ -0,0 +1,370 @@
+#pragma once
+
+#include "loggable_espidf.hpp"
+#include "loggable_espidf_latency.hpp"
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <atomic>
+#include <cstdarg>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#ifndef CONFIG_LOGGABLE_ESPIDF_TLS_INDEX
+#define CONFIG_LOGGABLE_ESPIDF_TLS_INDEX 1
+#endif
+
+#ifndef CONFIG_LOGGABLE_ESPIDF_TASK_NAMES
+#define CONFIG_LOGGABLE_ESPIDF_TASK_NAMES 32
+#endif
+
+static_assert(CONFIG_LOGGABLE_ESPIDF_TLS_INDEX < configNUM_THREAD_LOCAL_STORAGE_POINTERS,
+              "LOGGABLE_ESPIDF_TLS_INDEX must be below FREERTOS_THREAD_LOCAL_STORAGE_POINTERS");
+
+namespace loggable {
+namespace espidf {
+namespace detail {
+
+/// Sentinel stored in TaskContext::level_override when the task has none.
+inline constexpr uint8_t kNoLevelOverride = 0xFF;
+
+/// Number of complete records currently held for continuation lines.
+extern std::atomic<uint32_t> held_records;
+
+/**
+ * @brief Per-task state of the log hook.
+ *
+ * Lives in the FreeRTOS thread local storage slot
+ * `CONFIG_LOGGABLE_ESPIDF_TLS_INDEX`. When the task is deleted the TLS
+ * deletion callback hands the context to the drain side, which flushes any
+ * partial line and frees it.
+ */
+struct TaskContext {
+    std::atomic<uint8_t> level_override{kNoLevelOverride};
+    uint16_t task_id = 0;   ///< Interned id, see task_name().
+    const char* name = "";  ///< Cached pcTaskGetName(), owned by the TCB.
+
+    /// Text of the line being assembled; guarded by acquire_buffer().
+    std::string log_buffer;
+    uint32_t format_cycles = 0;
+    uint8_t partial_core = 0;
+    /// Latency stamps of the log call that started the record in log_buffer.
+    [[no_unique_address]] LatencyStamps stamps{};
+    /// log_buffer holds a complete record waiting for continuation lines.
+    std::atomic<bool> record_held{false};
+    /// Set while the task prints to the console only, e.g. a buffer dump
+    /// that is captured separately as a blob.
+    bool capture_suppressed = false;
+    /// Nesting depth of sink dispatch (Sinker and record sinks) on this task.
+    uint8_t sink_dispatch_depth = 0;
+    /// Set while the vprintf hook runs on this task; attributes heap allocations.
+    bool in_hook = false;
+    /// esp_log_timestamp() at the start of the rate limit window.
+    uint32_t rate_window_ms = 0;
+    /// Lines committed in the current rate limit window.
+    uint16_t rate_lines = 0;
+    /// esp_log_timestamp() when log_buffer became non-empty, 0 while empty.
+    std::atomic<uint32_t> partial_since_ms{0};
+
+    /**
+     * @brief Claim log_buffer for the owning task.
+     *
+     * Uncontended unless the sweeper is flushing this very buffer, in which
+     * case the owner sleeps a tick rather than spin against it.
+     */
+    void acquire_buffer() noexcept {
+        uint8_t expected = kBufferFree;
+        while (!_buffer_owner.compare_exchange_weak(expected, kBufferOwner, std::memory_order_acquire)) {
+            expected = kBufferFree;
+            vTaskDelay(1);
+        }
+    }
+
+    /**
+     * @brief Claim log_buffer for the sweeper, failing if the owner has it.
+     */
+    bool try_acquire_buffer_for_sweep() noexcept {
+        uint8_t expected = kBufferFree;
+        return _buffer_owner.compare_exchange_strong(expected, kBufferSweeper, std::memory_order_acquire);
+    }
+
+    void release_buffer() noexcept { _buffer_owner.store(kBufferFree, std::memory_order_release); }
+
+    /// Mark log_buffer as a complete record held for continuations.
+    void hold() noexcept {
+        record_held = true;
+        held_records.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /// Clear the held mark once the record has been taken out.
+    void release_held() noexcept {
+        if (record_held) {
+            record_held = false;
+            held_records.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    TaskContext* prev = nullptr;    ///< Registry links, guarded by the context mutex.
+    TaskContext* next = nullptr;
+    TaskContext* orphan = nullptr;  ///< Link in the list of deleted tasks.
+
+private:
+    static constexpr uint8_t kBufferFree = 0;
+    static constexpr uint8_t kBufferOwner = 1;
+    static constexpr uint8_t kBufferSweeper = 2;
+    std::atomic<uint8_t> _buffer_owner{kBufferFree};
+};
+
+/**
+ * @brief Marks the calling task as inside a logging entry point.
+ *
+ * Sinks delivering synchronously run on the logging task; whatever they log
+ * through the hook, LogHook::log_buffer() or log() is dropped instead of
+ * recursing into the sinks again.
+ */
+class ReentryGuard {
+public:
+    ReentryGuard() noexcept : _entered(!flag()) {
+        if (_entered) {
+            flag() = true;
+        }
+    }
+    ~ReentryGuard() {
+        if (_entered) {
+            flag() = false;
+        }
+    }
+
+    ReentryGuard(const ReentryGuard&) = delete;
+    ReentryGuard& operator=(const ReentryGuard&) = delete;
+
+    /// false if the task was already logging; the caller must drop its record.
+    explicit operator bool() const noexcept { return _entered; }
+
+private:
+    static bool& flag() noexcept {
+#if defined(CONFIG_IDF_TARGET_ESP32C3)
+        // ESP32-C3 either has broken TLS or some strange config option that needs tweaking i haven't found, use static instead (safe on single-core)
+        static bool is_logging = false;
+#else
+        thread_local bool is_logging = false;
+#endif
+        return is_logging;
+    }
+
+    bool _entered;
+};
+
+/**
+ * @brief Get the context of a task without creating it.
+ * @param task Task handle, or nullptr for the calling task.
+ * @return The context, or nullptr if the task has none yet.
+ */
+inline TaskContext* find_task_context(TaskHandle_t task = nullptr) noexcept {
+    return static_cast<TaskContext*>(
+        pvTaskGetThreadLocalStoragePointer(task, CONFIG_LOGGABLE_ESPIDF_TLS_INDEX));
+}
+
+/**
+ * @brief Get the context of a task, creating it on first use.
+ * @param task Task handle, or nullptr for the calling task.
+ * @return The context, or nullptr if it could not be allocated.
+ */
+TaskContext* get_task_context(TaskHandle_t task = nullptr) noexcept;
+
+/**
+ * @brief Check a task's rate limit and charge one record to it.
+ *
+ * Called with the task's buffer claimed, by the task itself or by the
+ * sweeper, so the window state is never updated concurrently.
+ *
+ * @param lines_per_second Limit, 0 for none.
+ */
+bool rate_allows(TaskContext& ctx, uint16_t lines_per_second, uint32_t now) noexcept;
+
+/**
+ * @brief Flush stale partial lines and reclaim contexts of deleted tasks.
+ *
+ * Partial lines older than HookConfig::partial_line_timeout_ms and held
+ * records older than the continuation window are dispatched as complete
+ * records. Called periodically by the drain task,
+ * which also owns the dispatch of the flushed text.
+ */
+void sweep_task_contexts(bool flush_all = false) noexcept;
+
+/**
+ * @brief Release the line buffers of tasks that have nothing buffered.
+ *
+ * Used by the memory governor; buffers grow back on the next line.
+ */
+void trim_task_buffers() noexcept;
+
+/**
+ * @brief Name of a task by interned id.
+ *
+ * Names are copied once, when the task's context is created, into a table of
+ * `CONFIG_LOGGABLE_ESPIDF_TASK_NAMES` entries, so the returned pointer stays
+ * valid after the task is deleted.
+ *
+ * @return The name, or "?" if the id has since been recycled.
+ */
+const char* task_name(uint16_t task_id) noexcept;
+
+/// Level applied to tasks that have no override of their own.
+extern std::atomic<uint8_t> default_task_level;
+
+/**
+ * @brief Extract the level of an ESP-IDF log line from its format string.
+ *
+ * Recognizes the `LOG_FORMAT` header (`"[color]L (%lu) %s: ..."`) so the level
+ * is known before anything is formatted.
+ *
+ * @return The level, or `ESP_LOG_NONE` if the format carries no header.
+ */
+inline esp_log_level_t level_from_format(const char* format) noexcept {
+    const char* p = format;
+    if (p[0] == '\033') {
+        while (*p && *p != 'm') {
+            ++p;
+        }
+        if (!*p) {
+            return ESP_LOG_NONE;
+        }
+        ++p;
+    }
+    // Short-circuits at the terminator of an empty or color-only format.
+    if (!p[0] || p[1] != ' ' || p[2] != '(') {
+        return ESP_LOG_NONE;
+    }
+    switch (p[0]) {
+        case 'E': return ESP_LOG_ERROR;
+        case 'W': return ESP_LOG_WARN;
+        case 'I': return ESP_LOG_INFO;
+        case 'D': return ESP_LOG_DEBUG;
+        case 'V': return ESP_LOG_VERBOSE;
+        default: return ESP_LOG_NONE;
+    }
+}
+
+/**
+ * @brief Get the tag argument of an ESP-IDF log call without formatting it.
+ *
+ * `LOG_FORMAT` passes the timestamp and the tag as the first two arguments
+ * (`"L (%" PRIu32 ") %s: "`); this checks the format has exactly that shape
+ * before reading them.
+ *
+ * @return The tag, or nullptr if the format does not start with the header.
+ */
+inline const char* tag_from_args(const char* format, va_list args) noexcept {
+    const char* p = format;
+    if (p[0] == '\033') {
+        p = std::strchr(p, 'm');
+        if (!p) {
+            return nullptr;
+        }
+        ++p;
+    }
+    if (!p[0] || p[1] != ' ' || p[2] != '(' || p[3] != '%') {
+        return nullptr;
+    }
+    p += 4;
+    while (*p == 'l') {
+        ++p;
+    }
+    if (*p != 'u' || std::strncmp(p + 1, ") %s:", 5) != 0) {
+        return nullptr;
+    }
+    va_list args_copy;
+    va_copy(args_copy, args);
+    (void)va_arg(args_copy, uint32_t);
+    const char* tag = va_arg(args_copy, const char*);
+    va_end(args_copy);
+    return tag;
+}
+
+/**
+ * @brief Check whether formatted text starts with an ESP-IDF header.
+ *
+ * Accepts an optional ANSI color sequence before the `"L ("` prefix. Text
+ * without a header continues the previous record of the same task.
+ */
+inline bool starts_with_header(std::string_view text) noexcept {
+    if (!text.empty() && text[0] == '\033') {
+        const size_t end = text.find('m');
+        if (end == std::string_view::npos) {
+            return false;
+        }
+        text.remove_prefix(end + 1);
+    }
+    if (text.size() < 3 || text[1] != ' ' || text[2] != '(') {
+        return false;
+    }
+    switch (text[0]) {
+        case 'E': case 'W': case 'I': case 'D': case 'V': return true;
+        default: return false;
+    }
+}
+
+/**
+ * @brief Most verbose level the memory governor lets through.
+ *
+ * ESP_LOG_VERBOSE unless under memory pressure. Checked by every entry point
+ * on its own, whether or not LOGGABLE_ESPIDF_HOOK_FILTERS is enabled, so
+ * lowering it never has to publish a new configuration. Defined in
+ * loggable_espidf_config.cpp.
+ */
+extern std::atomic<uint8_t> level_cap;
+
+/**
+ * @brief Check a level against the memory governor's cap.
+ */
+inline bool level_cap_allows(esp_log_level_t level) noexcept {
+    return level <= level_cap.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Check a format string's level against the memory governor's cap.
+ *
+ * Without a cap in effect this is a single load and compare.
+ */
+inline bool level_cap_allows(const char* format) noexcept {
+    if (level_cap.load(std::memory_order_relaxed) == ESP_LOG_VERBOSE) [[likely]] {
+        return true;
+    }
+    const esp_log_level_t level = level_from_format(format);
+    return level == ESP_LOG_NONE || level_cap_allows(level);
+}
+
+/**
+ * @brief Check whether the calling task may emit a line at `level`.
+ */
+inline bool task_level_allows_level(esp_log_level_t level) noexcept {
+    if (task_level_filters.load(std::memory_order_relaxed) == 0) [[likely]] {
+        return true;
+    }
+    const TaskContext* ctx = find_task_context();
+    uint8_t threshold = ctx ? ctx->level_override.load(std::memory_order_relaxed) : kNoLevelOverride;
+    if (threshold == kNoLevelOverride) {
+        threshold = default_task_level.load(std::memory_order_relaxed);
+    }
+    return level <= threshold;
+}
+
+/**
+ * @brief Check whether the calling task may emit a line with this format.
+ *
+ * With no per-task filter configured this is a single load and compare.
+ */
+inline bool task_level_allows(const char* format) noexcept {
+    if (task_level_filters.load(std::memory_order_relaxed) == 0) [[likely]] {
+        return true;
+    }
+    const esp_log_level_t level = level_from_format(format);
+    return level == ESP_LOG_NONE || task_level_allows_level(level);
+}
+
+} // namespace detail
+} // namespace espidf
+} // namespace loggable
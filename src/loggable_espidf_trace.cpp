@@ -0,0 +1,194 @@
+#include "loggable_espidf_trace.hpp"
+#include "loggable_espidf_capture.hpp"
+#include "loggable_espidf_task.hpp"
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+#ifndef CONFIG_LOGGABLE_ESPIDF_TRACE_EVENTS_PER_CORE
+#define CONFIG_LOGGABLE_ESPIDF_TRACE_EVENTS_PER_CORE 256
+#endif
+
+namespace loggable {
+namespace espidf {
+
+std::atomic<bool> PipelineTrace::_active{false};
+
+#if CONFIG_LOGGABLE_ESPIDF_TRACE_EVENTS
+
+namespace {
+
+constexpr uint32_t kEventsPerCore = CONFIG_LOGGABLE_ESPIDF_TRACE_EVENTS_PER_CORE;
+constexpr size_t kTaskSlots = CONFIG_LOGGABLE_ESPIDF_TASK_NAMES;
+
+/**
+ * @brief One ring slot.
+ *
+ * `sequence` is the event's index in the ring plus one once the fields are
+ * complete and 0 while they are being written, so readers skip torn or
+ * overwritten events like readers of a seqlock.
+ */
+struct TraceSlot {
+    std::atomic<uint32_t> sequence{0};
+    uint32_t time_us;
+    const char* name;
+    uint16_t task_id;
+    char phase;
+};
+
+/**
+ * @brief Ring of one core.
+ *
+ * Events go to the ring of the core that records them; tasks on other cores
+ * only touch it after migrating mid-event. The begin and end of a span may
+ * sit in different rings when the task migrates in between; the export
+ * files both under the task, and viewers pair them by time.
+ */
+struct alignas(64) CoreEvents {
+    std::atomic<uint32_t> next{0};
+    TraceSlot slots[kEventsPerCore];
+};
+
+static CoreEvents cores[portNUM_PROCESSORS];
+
+/// Pass a formatted piece to the writer.
+template <typename... Args>
+void emit(TraceWriter writer, void* user, const char* format, Args... args) {
+    char text[224];
+    const int length = std::snprintf(text, sizeof(text), format, args...);
+    if (length > 0) {
+        writer(std::string_view(text, static_cast<size_t>(length) < sizeof(text) ? length : sizeof(text) - 1), user);
+    }
+}
+
+/// Task ids that appear in the trace, for the thread name metadata.
+struct SeenTasks {
+    uint16_t ids[kTaskSlots];
+    size_t count = 0;
+
+    void add(uint16_t id) {
+        for (size_t i = 0; i < count; ++i) {
+            if (ids[i] == id) {
+                return;
+            }
+        }
+        if (count < kTaskSlots) {
+            ids[count++] = id;
+        }
+    }
+};
+
+/// Copy `text` escaped for the inside of a JSON string, truncated to fit `out`.
+template <size_t N>
+void json_escape(const char* text, char (&out)[N]) {
+    size_t length = 0;
+    for (; *text; ++text) {
+        const auto c = static_cast<unsigned char>(*text);
+        char escaped[7];
+        int size;
+        if (c == '"' || c == '\\') {
+            size = std::snprintf(escaped, sizeof(escaped), "\\%c", c);
+        } else if (c < 0x20) {
+            size = std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+        } else {
+            size = std::snprintf(escaped, sizeof(escaped), "%c", c);
+        }
+        if (length + size >= N) {
+            break;
+        }
+        std::memcpy(out + length, escaped, size);
+        length += size;
+    }
+    out[length] = '\0';
+}
+
+} // namespace
+
+void PipelineTrace::start() noexcept {
+    for (auto& core : cores) {
+        core.next.store(0, std::memory_order_relaxed);
+        for (auto& slot : core.slots) {
+            slot.sequence.store(0, std::memory_order_relaxed);
+        }
+    }
+    _active.store(true, std::memory_order_release);
+}
+
+void PipelineTrace::stop() noexcept {
+    _active.store(false, std::memory_order_release);
+}
+
+void PipelineTrace::record(const char* name, char phase) noexcept {
+    const detail::TaskContext* ctx = detail::find_task_context();
+    CoreEvents& core = cores[xPortGetCoreID()];
+    const uint32_t index = core.next.fetch_add(1, std::memory_order_relaxed);
+    TraceSlot& slot = core.slots[index % kEventsPerCore];
+
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.time_us = static_cast<uint32_t>(esp_timer_get_time());
+    slot.name = name;
+    slot.task_id = ctx ? ctx->task_id : 0;
+    slot.phase = phase;
+    slot.sequence.store(index + 1, std::memory_order_release);
+}
+
+bool PipelineTrace::export_chrome_json(TraceWriter writer, void* user) noexcept {
+    SeenTasks seen;
+    char name[64];
+
+    emit(writer, user, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    emit(writer, user, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"loggable\"}}");
+    for (uint32_t c = 0; c < portNUM_PROCESSORS; ++c) {
+        const CoreEvents& core = cores[c];
+        const uint32_t next = core.next.load(std::memory_order_acquire);
+        const uint32_t count = next < kEventsPerCore ? next : kEventsPerCore;
+        for (uint32_t index = next - count; index != next; ++index) {
+            const TraceSlot& slot = core.slots[index % kEventsPerCore];
+            if (slot.sequence.load(std::memory_order_acquire) != index + 1) {
+                continue;
+            }
+            const uint32_t time_us = slot.time_us;
+            const char* event_name = slot.name;
+            const uint16_t task_id = slot.task_id;
+            const char phase = slot.phase;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) != index + 1) {
+                continue;
+            }
+
+            json_escape(event_name, name);
+            emit(writer, user, ",{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%" PRIu32 ",\"pid\":0,\"tid\":%u%s,\"args\":{\"core\":%" PRIu32 "}}",
+                 name, phase, time_us, static_cast<unsigned>(task_id), phase == 'i' ? ",\"s\":\"t\"" : "", c);
+            seen.add(task_id);
+        }
+    }
+
+    for (size_t i = 0; i < seen.count; ++i) {
+        const uint16_t id = seen.ids[i];
+        json_escape(detail::task_name(id), name);
+        emit(writer, user, ",{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+             static_cast<unsigned>(id), name);
+    }
+    emit(writer, user, "]}");
+    return true;
+}
+
+#else
+
+void PipelineTrace::start() noexcept {}
+
+void PipelineTrace::stop() noexcept {}
+
+void PipelineTrace::record(const char*, char) noexcept {}
+
+bool PipelineTrace::export_chrome_json(TraceWriter, void*) noexcept {
+    return false;
+}
+
+#endif // CONFIG_LOGGABLE_ESPIDF_TRACE_EVENTS
+
+} // namespace espidf
+} // namespace loggable
@@ -0,0 +1,293 @@
+#include "loggable_espidf_traffic.hpp"
+#include "loggable_espidf_capture.hpp"
+#include "loggable_espidf_recorder.hpp"
+#include "loggable_os.hpp"
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <atomic>
+#include <charconv>
+#include <cinttypes>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+namespace loggable {
+
+namespace os {
+IAsyncBackend& get_freertos_backend() noexcept;
+} // namespace os
+
+namespace espidf {
+
+namespace {
+
+/// Records start on 4-byte boundaries so they can be read in place on hosts.
+constexpr size_t kAlignment = 4;
+
+constexpr size_t padded(size_t size) {
+    return (size + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+/// Literal per-level headers, as `ESP_LOGx` passes them, so the hook reads the level and tag from the call.
+constexpr const char* kReplayFormats[5] = {
+    "E (%" PRIu32 ") %s: %.*s", "W (%" PRIu32 ") %s: %.*s", "I (%" PRIu32 ") %s: %.*s",
+    "D (%" PRIu32 ") %s: %.*s", "V (%" PRIu32 ") %s: %.*s",
+};
+/// kReplayFormats behind ESP-IDF's default color of each level.
+constexpr const char* kColorReplayFormats[5] = {
+    "\033[0;31mE (%" PRIu32 ") %s: %.*s", "\033[0;33mW (%" PRIu32 ") %s: %.*s",
+    "\033[0;32mI (%" PRIu32 ") %s: %.*s", "D (%" PRIu32 ") %s: %.*s", "V (%" PRIu32 ") %s: %.*s",
+};
+
+/// Recorded output split at its `"L (timestamp) tag: "` header.
+struct ReplayHeader {
+    esp_log_level_t level = ESP_LOG_ERROR;
+    uint32_t timestamp = 0;
+    bool colored = false;
+    char tag[32] = {};
+    std::string_view body;
+};
+
+/**
+ * @brief Parse the header of a recorded output, after an optional color sequence.
+ * @return false for continuations of split lines and other headerless output.
+ */
+bool parse_header(std::string_view output, ReplayHeader& header) {
+    constexpr std::string_view kLevelLetters = "EWIDV";
+    size_t p = 0;
+    header.colored = !output.empty() && output[0] == '\033';
+    if (header.colored) {
+        p = output.find('m');
+        if (p == std::string_view::npos) {
+            return false;
+        }
+        ++p;
+    }
+    const size_t letter = p < output.size() ? kLevelLetters.find(output[p]) : std::string_view::npos;
+    if (letter == std::string_view::npos || output.substr(p + 1, 2) != " (") {
+        return false;
+    }
+    const char* const digits = output.data() + p + 3;
+    const auto [end, error] = std::from_chars(digits, output.data() + output.size(), header.timestamp);
+    const size_t tag_start = end - output.data() + 2;
+    if (error != std::errc() || output.substr(end - output.data(), 2) != ") ") {
+        return false;
+    }
+    const size_t tag_end = output.find(": ", tag_start);
+    if (tag_end == std::string_view::npos || tag_end - tag_start >= sizeof(header.tag)) {
+        return false;
+    }
+    std::memcpy(header.tag, output.data() + tag_start, tag_end - tag_start);
+    header.tag[tag_end - tag_start] = '\0';
+    header.level = static_cast<esp_log_level_t>(ESP_LOG_ERROR + letter);
+    header.body = output.substr(tag_end + 2);
+    return true;
+}
+
+} // namespace
+
+#if CONFIG_LOGGABLE_ESPIDF_TRAFFIC_RECORDER
+
+namespace detail {
+
+std::atomic<bool> traffic_recording{false};
+
+} // namespace detail
+
+namespace {
+
+// The buffer is only written by the hook while traffic_recording is set and
+// only read or freed after stop() has waited out the hook's read sections.
+static std::mutex traffic_mutex;
+static uint8_t* buffer = nullptr;
+static uint32_t capacity = 0;
+static std::atomic<uint32_t> write_offset{0};
+static std::atomic<uint32_t> record_count{0};
+static std::atomic<uint32_t> dropped_count{0};
+static int64_t start_us = 0;
+static bool finished = false;
+
+/// Whether the buffer may be freed: no hook can still be writing to it.
+bool writers_done() {
+    return !buffer || finished || detail::hook_rcu.synchronize(CONFIG_LOGGABLE_ESPIDF_QUIESCE_TIMEOUT_MS);
+}
+
+} // namespace
+
+namespace detail {
+
+void append_traffic(const char* format, std::string_view output, uint16_t task_id) noexcept {
+    const TrafficRecord record{static_cast<uint32_t>(esp_timer_get_time() - start_us),
+                               static_cast<uint32_t>(reinterpret_cast<uintptr_t>(format)), task_id,
+                               static_cast<uint16_t>(output.size() < UINT16_MAX ? output.size() : UINT16_MAX)};
+    const uint32_t size = padded(sizeof(record) + record.length);
+
+    uint32_t offset = write_offset.load(std::memory_order_relaxed);
+    do {
+        if (size > capacity - offset) {
+            dropped_count.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    } while (!write_offset.compare_exchange_weak(offset, offset + size, std::memory_order_relaxed));
+
+    std::memcpy(buffer + offset, &record, sizeof(record));
+    std::memcpy(buffer + offset + sizeof(record), output.data(), record.length);
+    record_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace detail
+
+bool TrafficRecorder::start(size_t size) noexcept {
+    std::lock_guard<std::mutex> lock(traffic_mutex);
+    if (detail::traffic_recording.load(std::memory_order_relaxed) || size < sizeof(TrafficTraceHeader) ||
+        size > UINT32_MAX || !writers_done()) {
+        return false;
+    }
+    delete[] buffer;
+    buffer = new (std::nothrow) uint8_t[size];
+    if (!buffer) {
+        capacity = 0;
+        return false;
+    }
+    capacity = static_cast<uint32_t>(size);
+    write_offset.store(padded(sizeof(TrafficTraceHeader)), std::memory_order_relaxed);
+    record_count.store(0, std::memory_order_relaxed);
+    dropped_count.store(0, std::memory_order_relaxed);
+    finished = false;
+    start_us = esp_timer_get_time();
+    detail::traffic_recording.store(true, std::memory_order_release);
+    return true;
+}
+
+bool TrafficRecorder::stop() noexcept {
+    std::lock_guard<std::mutex> lock(traffic_mutex);
+    if (!buffer || finished) {
+        return buffer != nullptr;
+    }
+    detail::traffic_recording.store(false, std::memory_order_release);
+    if (!detail::hook_rcu.synchronize(CONFIG_LOGGABLE_ESPIDF_QUIESCE_TIMEOUT_MS)) {
+        return false;
+    }
+
+    TrafficTraceHeader header{};
+    header.magic = kTrafficTraceMagic;
+    header.version = kTrafficTraceVersion;
+    header.header_size = sizeof(header);
+    header.size = write_offset.load(std::memory_order_relaxed);
+    header.records = record_count.load(std::memory_order_relaxed);
+    header.dropped = dropped_count.load(std::memory_order_relaxed);
+    std::memcpy(buffer, &header, sizeof(header));
+    finished = true;
+    return true;
+}
+
+bool TrafficRecorder::recording() noexcept {
+    return detail::traffic_recording.load(std::memory_order_relaxed);
+}
+
+std::string_view TrafficRecorder::trace() noexcept {
+    std::lock_guard<std::mutex> lock(traffic_mutex);
+    if (!finished) {
+        return {};
+    }
+    return {reinterpret_cast<const char*>(buffer), write_offset.load(std::memory_order_relaxed)};
+}
+
+void TrafficRecorder::release() noexcept {
+    std::lock_guard<std::mutex> lock(traffic_mutex);
+    if (detail::traffic_recording.load(std::memory_order_relaxed) || !writers_done()) {
+        return;
+    }
+    delete[] buffer;
+    buffer = nullptr;
+    capacity = 0;
+    finished = false;
+}
+
+#else
+
+bool TrafficRecorder::start(size_t) noexcept {
+    return false;
+}
+
+bool TrafficRecorder::stop() noexcept {
+    return false;
+}
+
+bool TrafficRecorder::recording() noexcept {
+    return false;
+}
+
+std::string_view TrafficRecorder::trace() noexcept {
+    return {};
+}
+
+void TrafficRecorder::release() noexcept {}
+
+#endif // CONFIG_LOGGABLE_ESPIDF_TRAFFIC_RECORDER
+
+bool replay_traffic(std::string_view trace, uint32_t speedup, ReplayResult* result) noexcept {
+    if (result) {
+        *result = ReplayResult{};
+    }
+    TrafficTraceHeader header;
+    if (trace.size() < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, trace.data(), sizeof(header));
+    if (header.magic != kTrafficTraceMagic || header.version != kTrafficTraceVersion ||
+        header.header_size < sizeof(header) || header.size > trace.size() || header.header_size > header.size) {
+        return false;
+    }
+
+    auto& backend = os::get_freertos_backend();
+    const int64_t replay_start = esp_timer_get_time();
+    size_t offset = padded(header.header_size);
+    uint32_t replayed = 0;
+    bool ok = true;
+    // Level and tag of the last header, for the continuations that follow it.
+    ReplayHeader line;
+    while (replayed < header.records) {
+        TrafficRecord record;
+        if (offset > header.size || header.size - offset < sizeof(record)) {
+            ok = false;
+            break;
+        }
+        std::memcpy(&record, trace.data() + offset, sizeof(record));
+        if (header.size - offset - sizeof(record) < record.length) {
+            ok = false;
+            break;
+        }
+
+        if (speedup != 0) {
+            const int64_t due = replay_start + record.time_us / speedup;
+            const int64_t ahead_us = due - esp_timer_get_time();
+            if (ahead_us >= 1000) {
+                backend.delay_ms(static_cast<uint32_t>(ahead_us / 1000));
+            }
+        }
+        const std::string_view output(trace.data() + offset + sizeof(record), record.length);
+        if (ReplayHeader parsed; parse_header(output, parsed)) {
+            line = parsed;
+            const size_t index = line.level - ESP_LOG_ERROR;
+            esp_log_write(line.level, line.tag, (line.colored ? kColorReplayFormats : kReplayFormats)[index],
+                          line.timestamp, line.tag, static_cast<int>(line.body.size()), line.body.data());
+        } else {
+            esp_log_write(line.level, line.tag, "%.*s", static_cast<int>(output.size()), output.data());
+        }
+
+        offset += padded(sizeof(record) + record.length);
+        ++replayed;
+    }
+
+    if (result) {
+        const int64_t elapsed_ms = (esp_timer_get_time() - replay_start) / 1000;
+        result->records = replayed;
+        result->duration_ms = static_cast<uint32_t>(elapsed_ms);
+        result->lines_per_second = elapsed_ms ? static_cast<uint32_t>(replayed * 1000ull / elapsed_ms) : 0;
+    }
+    return ok;
+}
+
+} // namespace espidf
+} // namespace loggable
@@ -0,0 +1,90 @@
+#include "loggable_espidf.hpp"
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <unity.h>
+#include <atomic>
+#include <cinttypes>
+#include <memory>
+
+#if CONFIG_LOGGABLE_ESPIDF_ALLOC_COUNTERS
+
+using loggable::espidf::AllocationBudget;
+using loggable::espidf::AllocationReport;
+using loggable::espidf::HookConfig;
+using loggable::espidf::IRecordSink;
+using loggable::espidf::LogHook;
+using loggable::espidf::Record;
+
+namespace {
+
+class NullSink : public IRecordSink {
+public:
+    std::atomic<uint32_t> lines{0};
+    void consume(const Record&) override { lines.fetch_add(1, std::memory_order_relaxed); }
+};
+
+/// Typical application lines: short, with arguments, near the hook's stack buffer, and warnings.
+void log_canonical_lines(uint32_t round) {
+    static const char long_body[] =
+        "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef"
+        "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef";
+    ESP_LOGI("canon", "started");
+    ESP_LOGI("canon_net", "connected to %s, rssi %d dBm, round %" PRIu32, "ap-1", -61, round);
+    ESP_LOGW("canon_net", "retry %" PRIu32 " after %d ms", round, 250);
+    ESP_LOGE("canon_io", "read failed: %s (0x%x)", "timeout", 0x107);
+    ESP_LOGI("canon_io", "%s", long_body);
+}
+
+/**
+ * Warm up, then check the allocations per line of a steady run against
+ * `budget` for the given routing.
+ */
+void check_steady_state(bool async_capture, bool route_to_sinker, const AllocationBudget& budget) {
+    auto sink = std::make_shared<NullSink>();
+    LogHook::add_record_sink(sink);
+    HookConfig config;
+    config.call_original_vprintf = false;
+    config.async_capture = async_capture;
+    config.route_to_sinker = route_to_sinker;
+    TEST_ASSERT_TRUE(LogHook::configure(config));
+    LogHook::install();
+
+    // The first lines grow the task's line buffer and the drain task's state.
+    log_canonical_lines(0);
+    vTaskDelay(pdMS_TO_TICKS(100));
+    (void)LogHook::allocation_report(true);
+
+    for (uint32_t round = 1; round <= 20; ++round) {
+        log_canonical_lines(round);
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+    vTaskDelay(pdMS_TO_TICKS(100));
+
+    AllocationReport report;
+    const bool within = LogHook::within_allocation_budget(budget, &report);
+    TEST_ASSERT_TRUE(LogHook::uninstall());
+    LogHook::remove_record_sink(sink);
+    TEST_ASSERT_TRUE(LogHook::configure(HookConfig{}));
+
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(100, report.hook_lines);
+    TEST_ASSERT_NOT_EQUAL(0, report.deliveries);
+    TEST_ASSERT_TRUE(within);
+}
+
+} // namespace
+
+TEST_CASE("async capture to record sinks does not allocate per line", "[loggable_espidf][alloc]") {
+    check_steady_state(true, false, AllocationBudget{0, 0});
+}
+
+TEST_CASE("synchronous delivery to record sinks does not allocate per line", "[loggable_espidf][alloc]") {
+    check_steady_state(false, false, AllocationBudget{0, 0});
+}
+
+TEST_CASE("routing to the Sinker stays within its LogMessage copies", "[loggable_espidf][alloc]") {
+    // LogMessage owns std::string copies of the tag and the payload.
+    check_steady_state(true, true, AllocationBudget{0, 2});
+}
+
+#endif // CONFIG_LOGGABLE_ESPIDF_ALLOC_COUNTERS
@@ -0,0 +1,119 @@
+#include "loggable_espidf.hpp"
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <unity.h>
+#include <atomic>
+#include <cinttypes>
+#include <cstring>
+#include <memory>
+
+using loggable::espidf::HookConfig;
+using loggable::espidf::IRecordSink;
+using loggable::espidf::LogHook;
+using loggable::espidf::Record;
+
+namespace {
+
+constexpr const char* TAG = "lifecycle";
+constexpr const char* kBody = "line from a producer ";
+constexpr int kProducers = 4;
+constexpr int kCycles = 50;
+
+/// Counts the test's lines and checks each arrives intact.
+class CountingSink : public IRecordSink {
+public:
+    std::atomic<uint32_t> lines{0};
+    std::atomic<uint32_t> corrupted{0};
+
+    void consume(const Record& record) override {
+        if (record.tag != TAG) {
+            return;
+        }
+        lines.fetch_add(1, std::memory_order_relaxed);
+        if (record.payload.substr(0, std::strlen(kBody)) != kBody) {
+            corrupted.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+};
+
+struct Producers {
+    std::atomic<bool> stop{false};
+    SemaphoreHandle_t done = xSemaphoreCreateCounting(kProducers, 0);
+};
+
+void producer_main(void* arg) {
+    auto& producers = *static_cast<Producers*>(arg);
+    for (uint32_t n = 0; !producers.stop.load(std::memory_order_relaxed); ++n) {
+        ESP_LOGI(TAG, "%s%" PRIu32, kBody, n);
+        // Paced so the capture buffer never fills and every line is delivered.
+        if (n % 8 == 7) {
+            vTaskDelay(1);
+        }
+    }
+    xSemaphoreGive(producers.done);
+    vTaskDelete(nullptr);
+}
+
+} // namespace
+
+TEST_CASE("install, configure and uninstall under load from both cores", "[loggable_espidf]") {
+    auto sink = std::make_shared<CountingSink>();
+    LogHook::add_record_sink(sink);
+    HookConfig config;
+    config.call_original_vprintf = false;
+    // Records are committed as soon as they end, so none is held at uninstall.
+    config.continuation_window_ms = 0;
+    TEST_ASSERT_TRUE(LogHook::configure(config));
+    (void)LogHook::volume_report(true);
+#if CONFIG_LOGGABLE_ESPIDF_SELF_REPORT
+    (void)LogHook::self_report(true);
+#endif
+
+    Producers producers;
+    TEST_ASSERT_NOT_NULL(producers.done);
+    for (int i = 0; i < kProducers; ++i) {
+        TEST_ASSERT_EQUAL(pdPASS, xTaskCreatePinnedToCore(producer_main, "lifecycle", 3072, &producers, 2, nullptr,
+                                                          i % portNUM_PROCESSORS));
+    }
+
+    for (int cycle = 0; cycle < kCycles; ++cycle) {
+        LogHook::install();
+        config.async_capture = cycle % 2 == 0;
+        TEST_ASSERT_TRUE(LogHook::configure(config));
+        vTaskDelay(pdMS_TO_TICKS(10));
+        TEST_ASSERT_TRUE(LogHook::uninstall());
+    }
+
+    producers.stop.store(true, std::memory_order_relaxed);
+    for (int i = 0; i < kProducers; ++i) {
+        TEST_ASSERT_EQUAL(pdTRUE, xSemaphoreTake(producers.done, pdMS_TO_TICKS(1000)));
+    }
+    vSemaphoreDelete(producers.done);
+    LogHook::remove_record_sink(sink);
+    TEST_ASSERT_TRUE(LogHook::configure(HookConfig{}));
+
+    TEST_ASSERT_NOT_EQUAL(0, sink->lines.load());
+    TEST_ASSERT_EQUAL_UINT32(0, sink->corrupted.load());
+    TEST_ASSERT_TRUE(heap_caps_check_integrity_all(true));
+
+#if CONFIG_LOGGABLE_ESPIDF_VOLUME_STATS
+    // Every line the hook committed was either delivered or dropped.
+    static loggable::espidf::VolumeReport report;
+    report = LogHook::volume_report();
+    uint32_t committed = 0;
+    for (size_t i = 0; i < report.tag_count; ++i) {
+        if (std::strcmp(report.tags[i].name, TAG) == 0) {
+            committed = report.tags[i].lines;
+        }
+    }
+#if CONFIG_LOGGABLE_ESPIDF_SELF_REPORT
+    const uint32_t dropped = LogHook::self_report().dropped_lines;
+#else
+    const uint32_t dropped = 0;
+#endif
+    TEST_ASSERT_EQUAL_UINT32(committed, sink->lines.load() + dropped);
+#endif
+}
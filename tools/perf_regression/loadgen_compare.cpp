@@ -0,0 +1,151 @@
+// Compares load results from the benchmarks app with committed baselines.
+//
+//   loadgen_compare [--throughput=N] [--latency=N] [--allocations=N] [--memory=N] BASELINES RESULTS
+//
+// Both files hold one LoadGenerator::to_json() document per line; text
+// before the first '{' of a line, such as a console log prefix, is skipped
+// and lines without one are ignored. Every baseline must have a result of
+// the same profile. Exits 1 if any metric regressed beyond its threshold
+// (percent of the baseline), 2 on bad input.
+#include "loggable_espidf_loadgen.hpp"
+#include <charconv>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using loggable::espidf::LoadGenerator;
+using loggable::espidf::LoadProfile;
+using loggable::espidf::LoadResult;
+using loggable::espidf::LoadThresholds;
+
+namespace {
+
+struct Run {
+    LoadProfile profile;
+    LoadResult result;
+};
+
+bool read_runs(const char* path, std::vector<Run>& runs) {
+    std::ifstream in(path);
+    if (!in) {
+        std::fprintf(stderr, "%s: cannot open\n", path);
+        return false;
+    }
+    std::string line;
+    for (size_t number = 1; std::getline(in, line); ++number) {
+        const size_t start = line.find('{');
+        if (start == std::string::npos) {
+            continue;
+        }
+        Run run;
+        if (!LoadGenerator::from_json(std::string_view(line).substr(start), run.profile, run.result)) {
+            std::fprintf(stderr, "%s:%zu: not a load result\n", path, number);
+            return false;
+        }
+        runs.push_back(run);
+    }
+    return true;
+}
+
+/// Fields to_json() writes; the rest are not recorded and always match.
+bool same_profile(const LoadProfile& a, const LoadProfile& b) {
+    return a.seed == b.seed && a.tasks == b.tasks && a.pinned == b.pinned && a.duration_ms == b.duration_ms &&
+           a.lines_per_second == b.lines_per_second && a.tag_count == b.tag_count &&
+           a.min_line_length == b.min_line_length && a.max_line_length == b.max_line_length &&
+           a.partial_percent == b.partial_percent && a.burst_percent == b.burst_percent;
+}
+
+bool parse_threshold(std::string_view arg, std::string_view name, uint8_t& out) {
+    if (arg.substr(0, name.size()) != name) {
+        return false;
+    }
+    arg.remove_prefix(name.size());
+    unsigned value;
+    const auto [end, error] = std::from_chars(arg.data(), arg.data() + arg.size(), value);
+    if (error != std::errc() || end != arg.data() + arg.size() || value > 255) {
+        return false;
+    }
+    out = static_cast<uint8_t>(value);
+    return true;
+}
+
+void describe(const LoadProfile& profile, char* out, size_t size) {
+    std::snprintf(out, size, "seed=%u tasks=%zu %s rate=%u partial=%u%% burst=%u%%", static_cast<unsigned>(profile.seed),
+                  profile.tasks, profile.pinned ? "pinned" : "unpinned", static_cast<unsigned>(profile.lines_per_second),
+                  profile.partial_percent, profile.burst_percent);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    LoadThresholds thresholds;
+    std::vector<const char*> paths;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        if (arg.substr(0, 2) != "--") {
+            paths.push_back(argv[i]);
+        } else if (!parse_threshold(arg, "--throughput=", thresholds.throughput_percent) &&
+                   !parse_threshold(arg, "--latency=", thresholds.latency_percent) &&
+                   !parse_threshold(arg, "--allocations=", thresholds.allocations_percent) &&
+                   !parse_threshold(arg, "--memory=", thresholds.memory_percent)) {
+            std::fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+    if (paths.size() != 2) {
+        std::fprintf(stderr,
+                     "usage: %s [--throughput=N] [--latency=N] [--allocations=N] [--memory=N] BASELINES RESULTS\n",
+                     argv[0]);
+        return 2;
+    }
+
+    std::vector<Run> baselines;
+    std::vector<Run> results;
+    if (!read_runs(paths[0], baselines) || !read_runs(paths[1], results)) {
+        return 2;
+    }
+    if (baselines.empty()) {
+        std::fprintf(stderr, "%s: no baselines\n", paths[0]);
+        return 2;
+    }
+
+    static constexpr std::pair<uint32_t, const char*> kMetrics[] = {
+        {loggable::espidf::kLoadThroughput, "throughput"}, {loggable::espidf::kLoadLatencyP50, "latency_p50"},
+        {loggable::espidf::kLoadLatencyP99, "latency_p99"}, {loggable::espidf::kLoadAllocations, "allocations"},
+        {loggable::espidf::kLoadPeakMemory, "peak_memory"},  {loggable::espidf::kLoadDrops, "drops"},
+    };
+    bool regressed = false;
+    bool missing = false;
+    for (const Run& baseline : baselines) {
+        char name[128];
+        describe(baseline.profile, name, sizeof(name));
+        const Run* current = nullptr;
+        for (const Run& result : results) {
+            if (same_profile(baseline.profile, result.profile)) {
+                current = &result;
+            }
+        }
+        if (!current) {
+            std::printf("MISSING %s\n", name);
+            missing = true;
+            continue;
+        }
+        const uint32_t regressions = LoadGenerator::compare(baseline.result, current->result, thresholds);
+        std::printf("%s %s: %u lines/s, p99 %u cycles, %u allocations, %u dropped", regressions ? "FAIL" : "PASS",
+                    name, static_cast<unsigned>(current->result.lines_per_second),
+                    static_cast<unsigned>(current->result.latency_p99),
+                    static_cast<unsigned>(current->result.allocations),
+                    static_cast<unsigned>(current->result.dropped_lines));
+        for (const auto& [metric, metric_name] : kMetrics) {
+            if (regressions & metric) {
+                std::printf(" [%s regressed]", metric_name);
+            }
+        }
+        std::printf("\n");
+        regressed |= regressions != 0;
+    }
+    return missing ? 2 : regressed ? 1 : 0;
+}